@@ -0,0 +1,151 @@
+#pragma once
+
+#include "trie.h"
+
+/*
+Multi-pattern matcher compiled from the keys of a trie. Every occurrence of
+every key in a text is reported in a single pass over the text.
+
+The automaton refers to the trie's nodes; it must be rebuilt after the trie is
+modified.
+*/
+template <class TrieT>
+class aho_corasick {
+public:
+  typedef typename TrieT::key_type key_type;
+  typedef typename TrieT::size_type size_type;
+  typedef typename TrieT::pointer pointer;
+  typedef typename TrieT::iterator iterator;
+  typedef typename TrieT::alphabet_type alphabet_type;
+  typedef unsigned int state_type;
+
+  enum transition_table {
+    /* only the trie's edges are stored, missing ones follow failure links while scanning */
+    sparse,
+    /* a state x alphabet table with every transition resolved, for small alphabets */
+    dense
+  };
+
+  explicit aho_corasick(TrieT &patterns, transition_table table = sparse)
+    : _alphabet(&patterns._alphabet), _table(table) {
+    build_states(&patterns._root);
+    build_links();
+    if (_table == dense)
+      build_dense();
+  }
+
+  /*
+  Calls callback(position, pattern) for every occurrence of a pattern in text,
+  where position is the offset of its first symbol. Occurrences are reported in
+  order of their last symbol, longest first. The empty key is never reported.
+  */
+  template <class SequenceT, class CallbackT>
+  void scan(const SequenceT &text, CallbackT callback) const {
+    scan(_std::begin(text), _std::end(text), callback);
+  }
+
+  template <class IterT, class EndT, class CallbackT>
+  void scan(IterT first, EndT last, CallbackT callback) const {
+    state_type current = root;
+    for (size_type position = 1; first != last; ++first, ++position) {
+      auto index = _alphabet->index_of(*first);
+      current = index < 0 ? root : next(current, index);
+      auto out = _states[current].active ? current : _states[current].output;
+      for (; out != root; out = _states[out].output)
+        callback(position - _states[out].depth, iterator(_states[out].node));
+    }
+  }
+
+  size_type states() const {
+    return _states.size();
+  }
+
+private:
+  static const state_type root = 0;
+
+  struct state {
+    pointer node;
+    state_type fail, output;
+    size_type depth;
+    size_type first_edge, last_edge;
+    bool active;
+  };
+
+  struct edge {
+    int index;
+    state_type target;
+  };
+
+  const alphabet_type *_alphabet;
+  transition_table _table;
+  std::vector<state> _states;
+  std::vector<edge> _edges;
+  std::vector<state_type> _dense;
+
+  /* numbers the trie's nodes breadth first, so a state's failure target always precedes it */
+  void build_states(pointer node) {
+    _states.push_back(make_state(node, 0));
+    for (size_type i = 0; i < _states.size(); ++i) {
+      pointer current = _states[i].node;
+      _states[i].first_edge = _edges.size();
+      for (int k = current->next_child(0); k >= 0; k = current->next_child(k + 1)) {
+        edge e = { k, state_type(_states.size()) };
+        _edges.push_back(e);
+        _states.push_back(make_state(current->child(k), _states[i].depth + 1));
+      }
+      _states[i].last_edge = _edges.size();
+    }
+  }
+
+  state make_state(pointer node, size_type depth) const {
+    state s = { node, root, root, depth, 0, 0, node->_parent && node->active() };
+    return s;
+  }
+
+  void build_links() {
+    for (size_type i = 0; i < _states.size(); ++i)
+      for (size_type e = _states[i].first_edge; e < _states[i].last_edge; ++e) {
+        state &child = _states[_edges[e].target];
+        if (i != root) {
+          state_type fail = _states[i].fail;
+          const edge *target;
+          while (!((target = find_edge(fail, _edges[e].index))) && fail != root)
+            fail = _states[fail].fail;
+          child.fail = target ? target->target : root;
+        }
+        child.output = _states[child.fail].active ? child.fail : _states[child.fail].output;
+      }
+  }
+
+  void build_dense() {
+    size_type width = _alphabet->size();
+    _dense.assign(_states.size() * width, state_type(root));
+    for (size_type i = 0; i < _states.size(); ++i)
+      for (size_type k = 0; k < width; ++k) {
+        const edge *target = find_edge(state_type(i), int(k));
+        if (target)
+          _dense[i * width + k] = target->target;
+        else if (i != root)
+          _dense[i * width + k] = _dense[_states[i].fail * width + k];
+      }
+  }
+
+  const edge *find_edge(state_type from, int index) const {
+    auto first = _edges.begin() + _states[from].first_edge;
+    auto last = _edges.begin() + _states[from].last_edge;
+    auto it = std::lower_bound(first, last, index, [](const edge &e, int i) { return e.index < i; });
+    return it != last && it->index == index ? &*it : nullptr;
+  }
+
+  state_type next(state_type current, int index) const {
+    if (_table == dense)
+      return _dense[current * _alphabet->size() + index];
+    const edge *target;
+    while (!((target = find_edge(current, index))))
+      if (current == root)
+        return root;
+      else
+        current = _states[current].fail;
+    return target->target;
+  }
+};
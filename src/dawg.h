@@ -0,0 +1,368 @@
+#pragma once
+
+#include "trie.h"
+
+namespace error {
+  struct invalid_dawg_insert : std::runtime_error {
+    explicit invalid_dawg_insert(const std::string &message) : std::runtime_error("invalid dawg insert: " + message) {}
+  };
+
+  struct dawg_not_finished : std::runtime_error {
+    dawg_not_finished() : std::runtime_error("dawg queried before finish") {}
+  };
+
+  struct key_index_out_of_range : std::runtime_error {
+    explicit key_index_out_of_range(const size_t index) : std::runtime_error("no key at index " + std::to_string(index)) {}
+  };
+}
+
+/*
+A set of keys stored as a minimal acyclic automaton (DAWG), which shares
+common suffixes as well as common prefixes. Keys are added in alphabet order
+and each finished state is merged with an equivalent one already built, so
+the automaton stays minimal during construction and the whole set never has
+to be held as a tree (Daciuk et al., incremental construction from sorted
+data).
+
+Every state counts the keys accepted from it, which numbers the keys
+0..size()-1 in order: index_of and key_at form a minimal perfect hash, so
+values can live in a plain array beside the dawg.
+
+finish must be called after the last key is added; queries before it throw,
+and keys cannot be added after it.
+*/
+template <class KeyT, class PredT = std::less<KeyT>>
+class dawg {
+public:
+  typedef KeyT key_type;
+  typedef PredT pred_type;
+  typedef alphabet<key_type, pred_type> alphabet_type;
+  typedef dawg<key_type, pred_type> self;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <class SequenceT>
+  explicit dawg(const SequenceT &alpha) : _alphabet(alpha), _root(0), _started(false), _finished(false), _registered(0) {
+    _path.push_back(path_state());
+  }
+
+  /* the minimal automaton for the keys of trie */
+  template <class TrieT>
+  static self minimize(TrieT &trie) {
+    self result(trie._alphabet);
+    std::vector<key_type> key(16);
+    if (trie.has(key.data(), 0))
+      result.insert(key.data(), 0);
+    for (auto &node : trie) {
+      size_t length = node.key_into(key.data(), key.size());
+      if (length > key.size()) {
+        key.resize(length);
+        node.key_into(key.data(), key.size());
+      }
+      result.insert(key.data(), length);
+    }
+    result.finish();
+    return result;
+  }
+
+  /* keys must be added in alphabet order; repeating the last key does nothing */
+  template <class SequenceT>
+  void insert(const SequenceT &key) {
+    add(_std::begin(key), _std::end(key));
+  }
+
+  template <class IterT>
+  void insert(IterT first, IterT last) {
+    add(first, last);
+  }
+
+  void insert(const key_type *key, size_type length) {
+    add(key, key + length);
+  }
+
+  /* minimizes the states of the last key added, after which no more can be */
+  void finish() {
+    if (_finished)
+      return;
+    freeze_path(0);
+    _root = freeze(_path[0]);
+    _path.clear();
+    _last.clear();
+    _register.clear();
+    _register.shrink_to_fit();
+    _finished = true;
+  }
+
+  template <class SequenceT>
+  bool has(const SequenceT &key) const {
+    return find(_std::begin(key), _std::end(key));
+  }
+
+  template <class IterT>
+  bool has(IterT first, IterT last) const {
+    return find(first, last);
+  }
+
+  bool has(const key_type *key, size_type length) const {
+    return find(key, key + length);
+  }
+
+  /* the position of key among the keys in order, or -1 if it is not stored */
+  template <class SequenceT>
+  difference_type index_of(const SequenceT &key) const {
+    return position(_std::begin(key), _std::end(key));
+  }
+
+  template <class IterT>
+  difference_type index_of(IterT first, IterT last) const {
+    return position(first, last);
+  }
+
+  difference_type index_of(const key_type *key, size_type length) const {
+    return position(key, key + length);
+  }
+
+  /* the key at position index among the keys in order */
+  template <class SequenceT>
+  SequenceT key_at(size_type index) const {
+    if (index >= size())
+      throw error::key_index_out_of_range(index);
+    SequenceT key;
+    for (unsigned s = _root;;) {
+      const state &current = _states[s];
+      if (current.final && !index--)
+        return key;
+      const edge *e = &_edges[current.first_edge];
+      for (; index >= _states[e->target].count; ++e)
+        index -= _states[e->target].count;
+      key.push_back(_alphabet.value_of(e->index));
+      s = e->target;
+    }
+  }
+
+  /* writes every key, as a SequenceT, in order */
+  template <class SequenceT, class OutputIt>
+  OutputIt keys(OutputIt out) const {
+    if (!_finished)
+      throw error::dawg_not_finished();
+    SequenceT key;
+    return keys(_root, key, out);
+  }
+
+  size_type size() const {
+    if (!_finished)
+      throw error::dawg_not_finished();
+    return _states[_root].count;
+  }
+
+  bool empty() const {
+    return !size();
+  }
+
+  size_type states() const {
+    return _states.size();
+  }
+
+  size_type transitions() const {
+    return _edges.size();
+  }
+
+private:
+  struct edge {
+    int index;
+    unsigned target;
+  };
+
+  struct state {
+    unsigned first_edge, edge_count;
+    size_type count;
+    bool final;
+  };
+
+  /* a state of the last key added, still open to new edges */
+  struct path_state {
+    std::vector<edge> edges;
+    bool final;
+
+    path_state() : final(false) {}
+  };
+
+  alphabet_type _alphabet;
+  std::vector<state> _states;
+  std::vector<edge> _edges;
+  unsigned _root;
+  bool _started, _finished;
+
+  std::vector<path_state> _path;
+  std::vector<int> _last, _key;
+
+  /* open addressing table of finished states by their edges, slots hold id + 1 */
+  std::vector<unsigned> _register;
+  size_type _registered;
+
+  explicit dawg(const alphabet_type &alpha) : _alphabet(alpha), _root(0), _started(false), _finished(false), _registered(0) {
+    _path.push_back(path_state());
+  }
+
+  template <class IterT, class EndT>
+  bool find(IterT first, EndT last) const {
+    if (!_finished)
+      throw error::dawg_not_finished();
+    unsigned s = _root;
+    for (; first != last; ++first)
+      if (!next(s, *first, s))
+        return false;
+    return _states[s].final;
+  }
+
+  template <class IterT, class EndT>
+  difference_type position(IterT first, EndT last) const {
+    if (!_finished)
+      throw error::dawg_not_finished();
+    size_type result = 0;
+    unsigned s = _root;
+    for (; first != last; ++first) {
+      const state &current = _states[s];
+      if (current.final)
+        ++result;
+      int index = _alphabet.index_of(*first);
+      const edge *found = index < 0 ? nullptr : find_edge(current, index);
+      if (!found)
+        return -1;
+      for (const edge *e = &_edges[current.first_edge]; e != found; ++e)
+        result += _states[e->target].count;
+      s = found->target;
+    }
+    return _states[s].final ? difference_type(result) : -1;
+  }
+
+  template <class IterT, class EndT>
+  void add(IterT first, EndT last) {
+    if (_finished)
+      throw error::invalid_dawg_insert("the dawg is finished");
+
+    _key.clear();
+    for (; first != last; ++first) {
+      int index = _alphabet.index_of(*first);
+      if (index < 0)
+        throw error::not_in_alphabet(*first);
+      _key.push_back(index);
+    }
+    add(_key);
+  }
+
+  void add(const std::vector<int> &key) {
+    size_t common = 0;
+    while (common < key.size() && common < _last.size() && key[common] == _last[common])
+      ++common;
+    if (_started && common == key.size() && common == _last.size())
+      return;
+    if (common < _last.size() && (common == key.size() || key[common] < _last[common]))
+      throw error::invalid_dawg_insert("keys are not in alphabet order");
+
+    freeze_path(common);
+    for (size_t i = common; i < key.size(); ++i) {
+      edge e = { key[i], 0 };
+      _path[i].edges.push_back(e);
+      _path.push_back(path_state());
+    }
+    _path.back().final = true;
+    _last = key;
+    _started = true;
+  }
+
+  /* replaces the states of the last key below depth with their minimized equivalents */
+  void freeze_path(const size_t depth) {
+    for (size_t i = _path.size() - 1; i > depth; --i)
+      _path[i - 1].edges.back().target = freeze(_path[i]);
+    _path.resize(depth + 1);
+  }
+
+  unsigned freeze(const path_state &open) {
+    state added = { unsigned(_edges.size()), unsigned(open.edges.size()), open.final ? 1u : 0u, open.final };
+    for (auto &e : open.edges) {
+      _edges.push_back(e);
+      added.count += _states[e.target].count;
+    }
+    _states.push_back(added);
+    const unsigned id = unsigned(_states.size() - 1);
+
+    if (_register.size() < (_registered + 1) * 2)
+      grow_register();
+    for (size_t slot = hash(id) & (_register.size() - 1);; slot = (slot + 1) & (_register.size() - 1)) {
+      if (!_register[slot]) {
+        _register[slot] = id + 1;
+        ++_registered;
+        return id;
+      }
+      if (equivalent(_register[slot] - 1, id)) {
+        _edges.resize(added.first_edge);
+        _states.pop_back();
+        return _register[slot] - 1;
+      }
+    }
+  }
+
+  void grow_register() {
+    std::vector<unsigned> old((std::max<size_t>)(_register.size() * 2, 1024));
+    old.swap(_register);
+    for (auto id : old)
+      if (id)
+        for (size_t slot = hash(id - 1) & (_register.size() - 1);; slot = (slot + 1) & (_register.size() - 1))
+          if (!_register[slot]) {
+            _register[slot] = id;
+            break;
+          }
+  }
+
+  size_t hash(const unsigned id) const {
+    const state &s = _states[id];
+    unsigned long long h = s.final ? 0x9e3779b97f4a7c15ull : 0;
+    for (unsigned i = 0; i < s.edge_count; ++i) {
+      const edge &e = _edges[s.first_edge + i];
+      h = (h ^ (static_cast<unsigned long long>(e.index) << 32 | e.target)) * 0x100000001b3ull;
+      h ^= h >> 29;
+    }
+    return size_t(h);
+  }
+
+  bool equivalent(const unsigned left, const unsigned right) const {
+    const state &l = _states[left], &r = _states[right];
+    if (l.final != r.final || l.edge_count != r.edge_count)
+      return false;
+    for (unsigned i = 0; i < l.edge_count; ++i) {
+      const edge &a = _edges[l.first_edge + i], &b = _edges[r.first_edge + i];
+      if (a.index != b.index || a.target != b.target)
+        return false;
+    }
+    return true;
+  }
+
+  const edge *find_edge(const state &s, const int index) const {
+    const edge *first = _edges.data() + s.first_edge, *last = first + s.edge_count;
+    const edge *found = std::lower_bound(first, last, index, [](const edge &e, int i) { return e.index < i; });
+    return found != last && found->index == index ? found : nullptr;
+  }
+
+  bool next(const unsigned s, const key_type &symbol, unsigned &target) const {
+    int index = _alphabet.index_of(symbol);
+    const edge *found = index < 0 ? nullptr : find_edge(_states[s], index);
+    if (found)
+      target = found->target;
+    return found != nullptr;
+  }
+
+  template <class SequenceT, class OutputIt>
+  OutputIt keys(const unsigned s, SequenceT &key, OutputIt out) const {
+    const state &current = _states[s];
+    if (current.final)
+      *out++ = key;
+    for (unsigned i = 0; i < current.edge_count; ++i) {
+      const edge &e = _edges[current.first_edge + i];
+      key.push_back(_alphabet.value_of(e.index));
+      out = keys(e.target, key, out);
+      key.pop_back();
+    }
+    return out;
+  }
+};
@@ -0,0 +1,493 @@
+#pragma once
+
+#include "trie.h"
+
+#if defined(_WIN32)
+/* keeps windows.h from defining min and max macros and the rarely used APIs */
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace error {
+  struct persistence_failure : std::runtime_error {
+    persistence_failure(const std::string &message, const std::string &path) : std::runtime_error("trie persistence failed, " + message + ": " + path) {}
+  };
+}
+
+struct durability_options {
+  /* mutations written and synced to the log together; a crash loses at most the group not yet committed */
+  size_t group_size;
+  /* mutations between automatic snapshots, or 0 to snapshot only when asked */
+  size_t snapshot_every;
+  /* whether commits and snapshots wait for the disk, without which a power loss can lose more */
+  bool sync;
+
+  durability_options() : group_size(64), snapshot_every(0), sync(true) {}
+};
+
+/*
+A trie whose mutations survive a crash. Every assign and erase is appended to
+a write-ahead log, and the log is written and synced a group of records at a
+time. A snapshot serializes the whole trie in depth first order on the
+calling thread, then writes it out on a background thread while new mutations
+go to a fresh log; once it is in place the logs it covers are deleted.
+
+Opening a path recovers it: the latest snapshot is bulk loaded into nodes and
+the logs after it are replayed, up to the first record torn by a crash.
+
+Files live beside path: path.snapshot and path.log.<generation>. Keys and
+values are persisted as their bytes, so both must be trivially copyable.
+*/
+template <class TrieT>
+class durable_trie {
+public:
+  typedef TrieT trie_type;
+  typedef typename trie_type::key_type key_type;
+  typedef typename trie_type::mapped_type mapped_type;
+  typedef typename trie_type::size_type size_type;
+  typedef typename trie_type::pointer pointer;
+  typedef typename trie_type::const_pointer const_pointer;
+  typedef typename trie_type::iterator iterator;
+  typedef durable_trie<trie_type> self;
+
+  static_assert(std::is_trivially_copyable<key_type>::value && std::is_trivially_copyable<mapped_type>::value,
+    "keys and values are persisted as their bytes");
+
+  template <class SequenceT>
+  durable_trie(const std::string &path, const SequenceT &alpha, const durability_options &options = durability_options())
+    : _path(path), _options(options), _trie(alpha), _log(nullptr), _generation(0), _pending(0), _since_snapshot(0), _replayed(0) {
+    recover();
+  }
+
+  durable_trie(const self &) = delete;
+  self &operator=(const self &) = delete;
+
+  ~durable_trie() {
+    try {
+      commit();
+      wait();
+    } catch (...) {
+    }
+    if (_log)
+      std::fclose(_log);
+  }
+
+  /*
+  Stores value under key and logs it. operator[] hands out a reference the
+  log cannot see written through, so writes go through assign instead.
+  */
+  template <class SequenceT>
+  void assign(const SequenceT &key, const mapped_type &value) {
+    store(_trie.insert(key, value), value);
+    log(put_record, _std::begin(key), _std::end(key), &value);
+  }
+
+  template <class IterT>
+  void assign(IterT first, IterT last, const mapped_type &value) {
+    store(_trie.insert(first, last, value), value);
+    log(put_record, first, last, &value);
+  }
+
+  void assign(const key_type *key, size_type length, const mapped_type &value) {
+    store(_trie.insert(key, length, value), value);
+    log(put_record, key, key + length, &value);
+  }
+
+  template <class SequenceT>
+  size_type erase(const SequenceT &key) {
+    return remove(_std::begin(key), _std::end(key));
+  }
+
+  template <class IterT>
+  size_type erase(IterT first, IterT last) {
+    return remove(first, last);
+  }
+
+  size_type erase(const key_type *key, size_type length) {
+    return remove(key, key + length);
+  }
+
+  /* the trie, for reads */
+  const trie_type &data() const {
+    return _trie;
+  }
+
+  /* writes and syncs the mutations logged since the last commit */
+  void commit() {
+    if (_batch.empty())
+      return;
+    if (std::fwrite(_batch.data(), 1, _batch.size(), _log) != _batch.size() || std::fflush(_log))
+      throw error::persistence_failure("cannot append to the log", log_path(_generation));
+    if (_options.sync)
+      sync(_log, log_path(_generation));
+    _batch.clear();
+    _pending = 0;
+  }
+
+  /*
+  Serializes the trie into memory on the calling thread, which takes time in
+  proportion to its size, and writes the image out on a background thread.
+  The trie is only read before this returns, so mutations may carry on while
+  the image is written. Waits for the previous snapshot first.
+  */
+  void snapshot() {
+    wait();
+    commit();
+    std::vector<char> image(magic, magic + sizeof magic);
+    put(image, static_cast<unsigned long long>(_generation + 1));
+    write_node(&_trie._root, image);
+    put(image, checksum(image.data(), image.size()));
+
+    ++_generation;
+    open_log();
+    _since_snapshot = 0;
+    _writer = std::thread([this](const std::vector<char> &image, const size_t generation) {
+      try {
+        write_snapshot(image, generation);
+      } catch (...) {
+        _failure = std::current_exception();
+      }
+    }, std::move(image), _generation);
+  }
+
+  /* waits for the snapshot being written, and rethrows if writing it failed */
+  void wait() {
+    if (_writer.joinable())
+      _writer.join();
+    if (_failure) {
+      std::exception_ptr failure = _failure;
+      _failure = nullptr;
+      std::rethrow_exception(failure);
+    }
+  }
+
+  /* log records applied when the trie was opened */
+  size_type replayed() const {
+    return _replayed;
+  }
+
+  /* deletes the snapshot and logs stored at path */
+  static void destroy(const std::string &path) {
+    std::vector<char> image;
+    size_t generation = read_file(path + ".snapshot", image) ? snapshot_generation(image) : 0;
+    remove_logs_before(path, generation);
+    while (!std::remove(log_path(path, generation).c_str()))
+      ++generation;
+    std::remove((path + ".snapshot").c_str());
+    std::remove((path + ".snapshot.tmp").c_str());
+  }
+
+private:
+  enum record_type : char {
+    put_record = 1,
+    erase_record = 2
+  };
+
+  static const char magic[8];
+
+  /* bytes read front to back, which fail rather than run past the end */
+  struct reader {
+    const char *at, *end;
+
+    bool take(void *out, const size_t size) {
+      if (size_t(end - at) < size)
+        return false;
+      if (size)
+        std::memcpy(out, at, size);
+      at += size;
+      return true;
+    }
+
+    bool varint(size_t &value) {
+      value = 0;
+      for (unsigned shift = 0; at != end && shift < 64; shift += 7) {
+        const unsigned char byte = static_cast<unsigned char>(*at++);
+        value |= size_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          return true;
+      }
+      return false;
+    }
+  };
+
+  const std::string _path;
+  const durability_options _options;
+  trie_type _trie;
+
+  std::FILE *_log;
+  size_t _generation;
+  /* records logged but not yet committed */
+  std::vector<char> _batch;
+  size_type _pending, _since_snapshot, _replayed;
+  std::vector<key_type> _key;
+
+  std::thread _writer;
+  std::exception_ptr _failure;
+
+  std::string snapshot_path() const {
+    return _path + ".snapshot";
+  }
+
+  std::string log_path(const size_t generation) const {
+    return log_path(_path, generation);
+  }
+
+  static std::string log_path(const std::string &path, const size_t generation) {
+    return path + ".log." + std::to_string(generation);
+  }
+
+  void recover() {
+    std::vector<char> image;
+    if (read_file(snapshot_path(), image))
+      load(image);
+    /* a crash between placing a snapshot and deleting its logs leaves them behind */
+    remove_logs_before(_path, _generation);
+    for (; read_file(log_path(_generation), image); ++_generation)
+      replay(image);
+    open_log();
+  }
+
+  /* fills the empty trie from a snapshot, creating each node directly below its parent */
+  void load(const std::vector<char> &image) {
+    if (image.size() < sizeof magic + sizeof(unsigned long long) + sizeof(unsigned)
+        || !std::equal(magic, magic + sizeof magic, image.begin()))
+      throw error::persistence_failure("not a snapshot", snapshot_path());
+    reader in = { image.data() + sizeof magic, image.data() + image.size() - sizeof(unsigned) };
+    unsigned expected;
+    std::memcpy(&expected, in.end, sizeof expected);
+    if (checksum(image.data(), image.size() - sizeof expected) != expected)
+      throw error::persistence_failure("corrupt snapshot", snapshot_path());
+
+    unsigned long long generation;
+    in.take(&generation, sizeof generation);
+    if (!read_node(&_trie._root, in) || in.at != in.end)
+      throw error::persistence_failure("corrupt snapshot", snapshot_path());
+    _generation = size_t(generation);
+  }
+
+  /* applies the records of a log up to the end or the first torn one */
+  void replay(const std::vector<char> &image) {
+    reader in = { image.data(), image.data() + image.size() };
+    while (in.at != in.end) {
+      const char *start = in.at;
+      char type;
+      size_t length;
+      mapped_type value = mapped_type();
+      unsigned expected;
+      if (!in.take(&type, 1) || (type != put_record && type != erase_record)
+          || !in.varint(length) || length > size_t(in.end - in.at) / sizeof(key_type))
+        return;
+      _key.resize(length);
+      if (!in.take(_key.data(), length * sizeof(key_type)) || (type == put_record && !in.take(&value, sizeof value)))
+        return;
+      const unsigned actual = checksum(start, size_t(in.at - start));
+      if (!in.take(&expected, sizeof expected) || actual != expected)
+        return;
+
+      if (type == put_record)
+        store(_trie.insert(_key.data(), length, value), value);
+      else
+        unlink(_key.data(), _key.data() + length);
+      ++_replayed;
+    }
+  }
+
+  void open_log() {
+    if (_log)
+      std::fclose(_log);
+    _log = std::fopen(log_path(_generation).c_str(), "wb");
+    if (!_log)
+      throw error::persistence_failure("cannot create the log", log_path(_generation));
+    if (_options.sync)
+      sync_directory(_path);
+  }
+
+  template <class IterT, class EndT>
+  void log(const record_type type, IterT first, EndT last, const mapped_type *value) {
+    const size_t start = _batch.size();
+    _batch.push_back(type);
+    size_t length = 0;
+    for (IterT it = first; it != last; ++it)
+      ++length;
+    put_varint(_batch, length);
+    for (; first != last; ++first)
+      put(_batch, key_type(*first));
+    if (value)
+      put(_batch, *value);
+    put(_batch, checksum(_batch.data() + start, _batch.size() - start));
+
+    if (++_pending >= _options.group_size)
+      commit();
+    if (_options.snapshot_every && ++_since_snapshot >= _options.snapshot_every)
+      snapshot();
+  }
+
+  static void store(const std::pair<iterator, bool> &inserted, const mapped_type &value) {
+    if (!inserted.second)
+      inserted.first->value() = value;
+  }
+
+  template <class IterT, class EndT>
+  size_type remove(IterT first, EndT last) {
+    if (!unlink(first, last))
+      return 0;
+    log(erase_record, first, last, nullptr);
+    return 1;
+  }
+
+  template <class IterT, class EndT>
+  bool unlink(IterT first, EndT last) {
+    pointer node = _trie._root.find(first, last);
+    if (!node || !node->_value.first)
+      return false;
+    _trie.erase(iterator(node));
+    return true;
+  }
+
+  /* runs on the writer thread, reading only its own arguments and the options */
+  void write_snapshot(const std::vector<char> &image, const size_t generation) const {
+    const std::string temporary = snapshot_path() + ".tmp";
+    std::FILE *file = std::fopen(temporary.c_str(), "wb");
+    if (!file)
+      throw error::persistence_failure("cannot create the snapshot", temporary);
+    const bool written = std::fwrite(image.data(), 1, image.size(), file) == image.size() && !std::fflush(file);
+    bool synced = true;
+    if (written && _options.sync)
+      synced = sync_file(file);
+    std::fclose(file);
+    if (!written || !synced)
+      throw error::persistence_failure("cannot write the snapshot", temporary);
+
+    if (!replace(temporary, snapshot_path()))
+      throw error::persistence_failure("cannot place the snapshot", snapshot_path());
+    if (_options.sync)
+      sync_directory(_path);
+    remove_logs_before(_path, generation);
+  }
+
+  /* each node is its flags, its value if it holds one, and its children as symbol and node */
+  static void write_node(const_pointer node, std::vector<char> &out) {
+    out.push_back(char(node->_value.first));
+    if (node->_value.first)
+      put(out, node->_value.second);
+    size_t children = 0;
+    if (!node->_nodes.empty())
+      for (int i = node->next_child(0); i >= 0; i = node->next_child(i + 1))
+        ++children;
+    put_varint(out, children);
+    if (children)
+      for (int i = node->next_child(0); i >= 0; i = node->next_child(i + 1)) {
+        const_pointer child = node->child(i);
+        put(out, child->_key);
+        write_node(child, out);
+      }
+  }
+
+  static bool read_node(pointer node, reader &in) {
+    char flags;
+    size_t children;
+    if (!in.take(&flags, 1) || ((flags & 1) && !in.take(&node->_value.second, sizeof(mapped_type))))
+      return false;
+    node->_value.first = (flags & 1) != 0;
+    if (!in.varint(children))
+      return false;
+    for (size_t i = 0; i < children; ++i) {
+      key_type symbol;
+      if (!in.take(&symbol, sizeof symbol) || !read_node(node->get_or_create_node(symbol), in))
+        return false;
+    }
+    return true;
+  }
+
+  static size_t snapshot_generation(const std::vector<char> &image) {
+    unsigned long long generation = 0;
+    if (image.size() >= sizeof magic + sizeof generation)
+      std::memcpy(&generation, image.data() + sizeof magic, sizeof generation);
+    return size_t(generation);
+  }
+
+  static void remove_logs_before(const std::string &path, size_t generation) {
+    while (generation && !std::remove(log_path(path, generation - 1).c_str()))
+      --generation;
+  }
+
+  template <class T>
+  static void put(std::vector<char> &out, const T &value) {
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+  }
+
+  static void put_varint(std::vector<char> &out, size_t value) {
+    for (; value >= 0x80; value >>= 7)
+      out.push_back(char(value | 0x80));
+    out.push_back(char(value));
+  }
+
+  /* FNV-1a */
+  static unsigned checksum(const char *data, const size_t size) {
+    unsigned h = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+      h = (h ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    return h;
+  }
+
+  static bool read_file(const std::string &path, std::vector<char> &contents) {
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+      return false;
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    contents.resize(size > 0 ? size_t(size) : 0);
+    const bool read = size >= 0 && std::fread(contents.data(), 1, contents.size(), file) == contents.size();
+    std::fclose(file);
+    if (!read)
+      throw error::persistence_failure("cannot read", path);
+    return true;
+  }
+
+  static void sync(std::FILE *file, const std::string &path) {
+    if (!sync_file(file))
+      throw error::persistence_failure("cannot sync", path);
+  }
+
+  static bool sync_file(std::FILE *file) {
+#if defined(_WIN32)
+    return !_commit(_fileno(file));
+#else
+    return !fsync(fileno(file));
+#endif
+  }
+
+  static bool replace(const std::string &from, const std::string &to) {
+#if defined(_WIN32)
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return !std::rename(from.c_str(), to.c_str());
+#endif
+  }
+
+  /* makes files created or renamed beside path durable; on Windows the rename already is */
+  static void sync_directory(const std::string &path) {
+#if !defined(_WIN32)
+    const size_t slash = path.find_last_of('/');
+    const int directory = open(slash == std::string::npos ? "." : path.substr(0, slash + 1).c_str(), O_RDONLY);
+    if (directory >= 0) {
+      fsync(directory);
+      close(directory);
+    }
+#endif
+  }
+};
+
+template <class TrieT>
+const char durable_trie<TrieT>::magic[8] = { 't', 'r', 'i', 'e', 's', 'n', 'a', 'p' };
@@ -0,0 +1,400 @@
+#pragma once
+
+#include "trie.h"
+
+namespace error {
+  struct invalid_prefix_length : std::runtime_error {
+    explicit invalid_prefix_length(const unsigned length) : std::runtime_error("prefix longer than key: " + std::to_string(length)) {}
+  };
+}
+
+template <class UIntT, class ElemT, unsigned SpanBits>
+class integer_trie;
+
+/*
+Node of an integer_trie. Each level consumes SpanBits bits of the key, most
+significant first, so children in index order are keys in numeric order.
+Keys are stored in leaves, nodes of depth levels holding the whole key. A
+leaf hangs from the shallowest node its key shares with no other, and is
+pushed down a level whenever another key or route needs its slot; routes,
+prefixes of any bit length, are stored in the node at the level their length
+ends in.
+*/
+template <class UIntT, class ElemT, unsigned SpanBits>
+class integer_trie_node {
+public:
+  typedef UIntT key_type;
+  typedef ElemT mapped_type;
+  typedef std::pair<bool, mapped_type> value_type;
+  typedef integer_trie_node<key_type, mapped_type, SpanBits> self;
+
+  friend integer_trie<key_type, mapped_type, SpanBits>;
+
+  static const unsigned key_bits = sizeof(key_type) * 8;
+  static const unsigned levels = key_bits / SpanBits;
+  static const size_t width = size_t(1) << SpanBits;
+
+  key_type key() const {
+    return _key;
+  }
+
+  mapped_type &value() {
+    return _value.second;
+  }
+
+  self *successor() {
+    self *node = this;
+    for (; node->_parent; node = node->_parent)
+      for (int i = node->_parent->_nodes.next(node->index() + 1, width); i >= 0; i = node->_parent->_nodes.next(i + 1, width))
+        if (self *first = node->_parent->_nodes.get(i, width)->first())
+          return first;
+    return node;
+  }
+
+  self *predecessor() {
+    self *node = this;
+    for (; node->_parent; node = node->_parent)
+      for (int i = node->_parent->_nodes.prev(node->index() - 1, width); i >= 0; i = node->_parent->_nodes.prev(i - 1, width))
+        if (self *last = node->_parent->_nodes.get(i, width)->last())
+          return last;
+    self *last = node == this ? node->last() : nullptr;
+    return last ? last : node;
+  }
+
+protected:
+
+  struct route {
+    unsigned bits, length;
+    mapped_type value;
+  };
+
+  value_type _value;
+  key_type _key;
+  unsigned _depth;
+  trie_children<self> _nodes;
+  self *_parent;
+  std::vector<route> *_routes;
+
+  integer_trie_node() : _value(), _key(0), _depth(0), _parent(nullptr), _routes(nullptr) {}
+
+  integer_trie_node(const key_type key, const unsigned depth, self *parent)
+    : _value(), _key(key), _depth(depth), _parent(parent), _routes(nullptr) {}
+
+  ~integer_trie_node() {
+    clear();
+  }
+
+  void clear() {
+    _value = value_type();
+    for (int i = _nodes.next(0, width); i >= 0; i = _nodes.next(i + 1, width))
+      delete _nodes.get(i, width);
+    _nodes.release();
+    delete _routes;
+    _routes = nullptr;
+  }
+
+  static unsigned digit_of(const key_type key, const unsigned depth) {
+    return unsigned(key >> (key_bits - (depth + 1) * SpanBits)) & unsigned(width - 1);
+  }
+
+  int index() const {
+    return int(digit_of(_key, _parent->_depth));
+  }
+
+  self *child(const unsigned digit) const {
+    return _nodes.get(int(digit), width);
+  }
+
+  /* the node below this one on the way to key at depth, splitting a leaf that stands in the way */
+  self *get_or_create_node(const key_type key, const unsigned depth) {
+    const unsigned digit = digit_of(key, _depth);
+    self *node = child(digit);
+    if (!node) {
+      if (depth == levels)
+        return add_child(digit, new self(key, levels, this));
+      return add_child(digit, new self(prefix(key), _depth + 1, this));
+    }
+    if (node->_depth < levels || (depth == levels && node->_key == key))
+      return node;
+    self *split = new self(prefix(key), _depth + 1, this);
+    try {
+      split->_nodes.set(int(digit_of(node->_key, _depth + 1)), node, width);
+    } catch (...) {
+      delete split;
+      throw;
+    }
+    node->_parent = split;
+    _nodes.exchange(int(digit), split, width);
+    return split;
+  }
+
+  self *add_child(const unsigned digit, self *node) {
+    try {
+      _nodes.set(int(digit), node, width);
+    } catch (...) {
+      delete node;
+      throw;
+    }
+    return node;
+  }
+
+  /* key cut to the spans down to the level below this node */
+  key_type prefix(const key_type key) const {
+    const unsigned cut = key_bits - (_depth + 1) * SpanBits;
+    return key_type(key >> cut << cut);
+  }
+
+  /* the first key stored in this subtree */
+  self *first() {
+    if (_depth == levels)
+      return _value.first ? this : nullptr;
+    for (int i = _nodes.next(0, width); i >= 0; i = _nodes.next(i + 1, width))
+      if (self *node = child(i)->first())
+        return node;
+    return nullptr;
+  }
+
+  /* the last key stored in this subtree */
+  self *last() {
+    if (_depth == levels)
+      return _value.first ? this : nullptr;
+    for (int i = _nodes.prev(int(width) - 1, width); i >= 0; i = _nodes.prev(i - 1, width))
+      if (self *node = child(i)->last())
+        return node;
+    return nullptr;
+  }
+
+  /* the first key not less than key in this subtree, whose prefix key shares */
+  self *lower_bound(const key_type key) {
+    if (_depth == levels)
+      return _value.first && _key >= key ? this : nullptr;
+    unsigned digit = digit_of(key, _depth);
+    if (self *node = child(digit))
+      if (self *found = node->lower_bound(key))
+        return found;
+    for (int i = _nodes.next(int(digit) + 1, width); i >= 0; i = _nodes.next(i + 1, width))
+      if (self *found = child(i)->first())
+        return found;
+    return nullptr;
+  }
+
+  route *find_route(const unsigned bits, const unsigned length) const {
+    if (_routes)
+      for (auto &it : *_routes)
+        if (it.bits == bits && it.length == length)
+          return &it;
+    return nullptr;
+  }
+
+  bool empty() const {
+    return !_value.first && _nodes.empty() && !_routes;
+  }
+
+  /* deletes empty nodes from here towards the root */
+  void prune() {
+    self *node = this;
+    while (node->_parent && node->empty()) {
+      self *parent = node->_parent;
+      parent->_nodes.reset(node->index(), width);
+      delete node;
+      node = parent;
+    }
+  }
+};
+
+/*
+Map keyed by unsigned integers, walked SpanBits bits at a time from the most
+significant end with no alphabet lookups. Iteration and lower_bound follow
+numeric order.
+
+It also holds routes: values for key prefixes of any bit length, as in a
+routing table, queried with longest_prefix_match. Routes are separate from
+the keys stored with operator[] and are not visited by iteration.
+*/
+template <class UIntT, class ElemT, unsigned SpanBits = 8>
+class integer_trie {
+public:
+  typedef UIntT key_type;
+  typedef ElemT mapped_type;
+  typedef integer_trie<key_type, mapped_type, SpanBits> self;
+  typedef integer_trie_node<key_type, mapped_type, SpanBits> value_type;
+
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef value_type *pointer;
+  typedef const value_type *const_pointer;
+  typedef value_type& reference;
+  typedef const value_type& const_reference;
+
+  typedef no_stats stats_type;
+  typedef trie_iterator<self> iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+
+  static_assert(value_type::key_bits % SpanBits == 0, "SpanBits must divide the key width");
+
+  integer_trie() : _size(0) {}
+
+  integer_trie(const self &) = delete;
+  self &operator=(const self &) = delete;
+
+  mapped_type &operator[](const key_type key) {
+    value_type *node = leaf(key);
+    if (!node->_value.first) {
+      node->_value.first = true;
+      ++_size;
+    }
+    return node->_value.second;
+  }
+
+  std::pair<iterator, bool> insert(const key_type key, const mapped_type &value) {
+    value_type *node = leaf(key);
+    if (node->_value.first)
+      return std::make_pair(iterator(node), false);
+    node->_value = typename value_type::value_type(true, value);
+    ++_size;
+    return std::make_pair(iterator(node), true);
+  }
+
+  iterator find(const key_type key) {
+    value_type *node = traverse(key, value_type::levels);
+    return node && node->_value.first ? iterator(node) : end();
+  }
+
+  bool has(const key_type key) {
+    value_type *node = traverse(key, value_type::levels);
+    return node && node->_value.first;
+  }
+
+  size_type erase(const key_type key) {
+    value_type *node = traverse(key, value_type::levels);
+    if (!node || !node->_value.first)
+      return 0;
+    node->_value = typename value_type::value_type();
+    node->prune();
+    --_size;
+    return 1;
+  }
+
+  iterator erase(iterator pos) {
+    auto curr = pos++;
+    erase(curr->key());
+    return pos;
+  }
+
+  /* the first key not less than key */
+  iterator lower_bound(const key_type key) {
+    value_type *node = _root.lower_bound(key);
+    return iterator(node ? node : &_root);
+  }
+
+  iterator upper_bound(const key_type key) {
+    iterator it = lower_bound(key);
+    return it != end() && it->key() == key ? ++it : it;
+  }
+
+  /* the value for the first length bits of prefix, created if missing */
+  mapped_type &route(const key_type prefix, const unsigned length) {
+    if (length > value_type::key_bits)
+      throw error::invalid_prefix_length(length);
+    value_type *node = traverse_and_create(prefix, length / SpanBits);
+    const unsigned bits = route_bits(prefix, length);
+    if (auto *found = node->find_route(bits, length))
+      return found->value;
+    if (!node->_routes)
+      node->_routes = new std::vector<typename value_type::route>();
+    typename value_type::route added = { bits, length, mapped_type() };
+    node->_routes->push_back(added);
+    return node->_routes->back().value;
+  }
+
+  size_type erase_route(const key_type prefix, const unsigned length) {
+    if (length > value_type::key_bits)
+      throw error::invalid_prefix_length(length);
+    value_type *node = traverse(prefix, length / SpanBits);
+    auto *found = node ? node->find_route(route_bits(prefix, length), length) : nullptr;
+    if (!found)
+      return 0;
+    node->_routes->erase(node->_routes->begin() + (found - node->_routes->data()));
+    if (node->_routes->empty()) {
+      delete node->_routes;
+      node->_routes = nullptr;
+      node->prune();
+    }
+    return 1;
+  }
+
+  /* the value and length of the longest route that prefixes key, or null and 0 */
+  std::pair<mapped_type *, unsigned> longest_prefix_match(const key_type key) {
+    std::pair<mapped_type *, unsigned> best(nullptr, 0);
+    for (value_type *node = &_root; node && (node->_depth < value_type::levels || node->_key == key);
+      node = node->_depth < value_type::levels ? node->child(value_type::digit_of(key, node->_depth)) : nullptr)
+      if (node->_routes)
+        for (auto &it : *node->_routes)
+          if ((!best.first || it.length >= best.second) && it.bits == route_bits(key, it.length))
+            best = std::make_pair(&it.value, it.length);
+    return best;
+  }
+
+  void clear() {
+    _root.clear();
+    _size = 0;
+  }
+
+  size_type size() const {
+    return _size;
+  }
+
+  bool empty() const {
+    return !_size;
+  }
+
+  iterator begin() {
+    value_type *node = _root.first();
+    return iterator(node ? node : &_root);
+  }
+
+  iterator end() {
+    return iterator(&_root);
+  }
+
+  reverse_iterator rbegin() {
+    return reverse_iterator(end());
+  }
+
+  reverse_iterator rend() {
+    return reverse_iterator(begin());
+  }
+
+protected:
+  value_type _root;
+  size_type _size;
+
+private:
+
+  /* the bits of prefix within its last, possibly partial, span */
+  static unsigned route_bits(const key_type prefix, const unsigned length) {
+    const unsigned depth = length / SpanBits, partial = length % SpanBits;
+    if (!partial)
+      return 0;
+    return value_type::digit_of(prefix, depth) >> (SpanBits - partial);
+  }
+
+  value_type *leaf(const key_type key) {
+    return traverse_and_create(key, value_type::levels);
+  }
+
+  /* the node of key at depth, or null; a leaf found on the way is only the node if it holds key */
+  value_type *traverse(const key_type key, const unsigned depth) {
+    value_type *node = &_root;
+    while (node && node->_depth < depth)
+      node = node->child(value_type::digit_of(key, node->_depth));
+    return node && node->_depth == depth && (depth < value_type::levels || node->_key == key) ? node : nullptr;
+  }
+
+  value_type *traverse_and_create(const key_type key, const unsigned depth) {
+    value_type *node = &_root;
+    while (node->_depth < depth)
+      node = node->get_or_create_node(key, depth);
+    return node;
+  }
+};
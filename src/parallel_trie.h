@@ -0,0 +1,281 @@
+#pragma once
+
+#include "trie.h"
+
+/*
+A fixed set of worker threads, each with its own deque of tasks. A worker
+takes its newest task first and, when out of work, steals the oldest task of
+another worker, so uneven tasks even out across threads. A thread waiting in
+run helps with the tasks instead of blocking.
+*/
+class work_stealing_pool {
+public:
+  explicit work_stealing_pool(size_t threads = std::thread::hardware_concurrency())
+    : _queues(threads ? threads : 1), _queued(0), _next(0), _stopping(false) {
+    for (size_t i = 0; i < _queues.size(); ++i)
+      _workers.emplace_back([this, i] { work(i); });
+  }
+
+  work_stealing_pool(const work_stealing_pool &) = delete;
+  work_stealing_pool &operator=(const work_stealing_pool &) = delete;
+
+  ~work_stealing_pool() {
+    {
+      std::lock_guard<std::mutex> guard(_sleep);
+      _stopping = true;
+    }
+    _wake.notify_all();
+    for (auto &it : _workers)
+      it.join();
+  }
+
+  /* a pool of one thread per core, shared by the parallel scans when none is given */
+  static work_stealing_pool &shared() {
+    static work_stealing_pool pool;
+    return pool;
+  }
+
+  size_t size() const {
+    return _workers.size();
+  }
+
+  /* calls task(i) for every i below count and returns once all have finished, rethrowing the first exception */
+  void run(const size_t count, const std::function<void(size_t)> &task) {
+    if (!count)
+      return;
+    batch work(task, count);
+    for (size_t i = 0; i < count; ++i)
+      push(_next++ % _queues.size(), item{ &work, i });
+
+    for (item next; work.remaining && steal(_queues.size(), next);)
+      execute(next);
+    {
+      std::unique_lock<std::mutex> guard(work.lock);
+      work.done.wait(guard, [&] { return !work.remaining; });
+    }
+    if (work.failure)
+      std::rethrow_exception(work.failure);
+  }
+
+private:
+  struct batch {
+    const std::function<void(size_t)> &task;
+    std::atomic<size_t> remaining;
+    std::exception_ptr failure;
+    std::mutex lock;
+    std::condition_variable done;
+
+    batch(const std::function<void(size_t)> &task, const size_t count) : task(task), remaining(count) {}
+  };
+
+  struct item {
+    batch *work;
+    size_t index;
+  };
+
+  struct queue {
+    std::mutex lock;
+    std::deque<item> items;
+  };
+
+  std::vector<queue> _queues;
+  std::vector<std::thread> _workers;
+  std::atomic<size_t> _queued, _next;
+  bool _stopping;
+  std::mutex _sleep;
+  std::condition_variable _wake;
+
+  void work(const size_t self) {
+    for (item next;;) {
+      if (pop(self, next) || steal(self, next)) {
+        execute(next);
+        continue;
+      }
+      std::unique_lock<std::mutex> guard(_sleep);
+      _wake.wait(guard, [&] { return _stopping || _queued; });
+      if (_stopping && !_queued)
+        return;
+    }
+  }
+
+  void push(const size_t to, const item &next) {
+    {
+      std::lock_guard<std::mutex> guard(_queues[to].lock);
+      _queues[to].items.push_back(next);
+    }
+    ++_queued;
+    std::lock_guard<std::mutex> guard(_sleep);
+    _wake.notify_one();
+  }
+
+  bool pop(const size_t self, item &next) {
+    std::lock_guard<std::mutex> guard(_queues[self].lock);
+    if (_queues[self].items.empty())
+      return false;
+    next = _queues[self].items.back();
+    _queues[self].items.pop_back();
+    --_queued;
+    return true;
+  }
+
+  /* takes the oldest task of any queue but self's, which is out of range for a thread outside the pool */
+  bool steal(const size_t self, item &next) {
+    for (size_t i = 1; i <= _queues.size(); ++i) {
+      const size_t index = (self + i) % _queues.size();
+      if (index == self)
+        continue;
+      queue &victim = _queues[index];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (victim.items.empty())
+        continue;
+      next = victim.items.front();
+      victim.items.pop_front();
+      --_queued;
+      return true;
+    }
+    return false;
+  }
+
+  static void execute(const item &next) {
+    batch &work = *next.work;
+    std::exception_ptr failure;
+    try {
+      work.task(next.index);
+    } catch (...) {
+      failure = std::current_exception();
+    }
+    /* the waiting thread only returns after taking the lock, so work outlives this */
+    std::lock_guard<std::mutex> guard(work.lock);
+    if (failure && !work.failure)
+      work.failure = failure;
+    if (!--work.remaining)
+      work.done.notify_all();
+  }
+};
+
+/*
+Splits a trie into parts that can be walked independently, in key order. The
+sizes of subtrees are unknown without walking them, so the top levels are
+split until there are many more parts than threads: a node splits into its
+own value and a part per child. Stealing then evens out the uneven parts.
+*/
+template <class TrieT>
+class trie_partition {
+public:
+  typedef typename TrieT::pointer pointer;
+  typedef typename TrieT::size_type size_type;
+
+  struct part {
+    pointer node;
+    /* the node's whole subtree, or only its own value */
+    bool subtree;
+  };
+
+  static const size_type parts_per_thread = 32;
+  static const size_type max_levels = 8;
+
+  static std::vector<part> split(const TrieT &trie, const size_type threads) {
+    std::vector<part> parts(1, part{ const_cast<pointer>(&trie._root), true });
+    std::vector<part> next;
+    for (size_type level = 0; level < max_levels && parts.size() < threads * parts_per_thread; ++level) {
+      next.clear();
+      bool split = false;
+      for (auto &it : parts) {
+        if (!it.subtree || it.node->_nodes.empty()) {
+          next.push_back(it);
+          continue;
+        }
+        if (it.node->_value.first)
+          next.push_back(part{ it.node, false });
+        for (int i = it.node->next_child(0); i >= 0; i = it.node->next_child(i + 1))
+          next.push_back(part{ it.node->child(i), true });
+        split = true;
+      }
+      parts.swap(next);
+      if (!split)
+        break;
+    }
+    return parts;
+  }
+
+  /* calls visit(node) for every node of the part holding a value, in key order */
+  template <class VisitT>
+  static void walk(const part &it, VisitT &visit) {
+    if (it.subtree)
+      walk(it.node, visit);
+    else
+      visit(it.node);
+  }
+
+private:
+  template <class VisitT>
+  static void walk(pointer node, VisitT &visit) {
+    if (node->_value.first)
+      visit(node);
+    if (!node->_nodes.empty())
+      for (int i = node->next_child(0); i >= 0; i = node->next_child(i + 1))
+        walk(node->child(i), visit);
+  }
+};
+
+/*
+Full scans spread across a work_stealing_pool, one task per trie_partition
+part. Every node holding a value is visited, including the root when the
+empty key is stored. TrieT may be const, in which case nodes are passed as
+const references. The trie must not be modified during a scan, though fn may
+write the values of the nodes it is given.
+*/
+
+/* calls fn(node) for every node holding a value, concurrently and in no particular order */
+template <class TrieT, class FuncT>
+void parallel_for_each(TrieT &trie, FuncT fn, work_stealing_pool &pool = work_stealing_pool::shared()) {
+  typedef typename std::remove_const<TrieT>::type trie_type;
+  typedef typename std::conditional<std::is_const<TrieT>::value, typename trie_type::const_reference, typename trie_type::reference>::type reference;
+  auto parts = trie_partition<trie_type>::split(trie, pool.size());
+  pool.run(parts.size(), [&](size_t i) {
+    auto visit = [&](typename trie_type::pointer node) { fn(static_cast<reference>(*node)); };
+    trie_partition<trie_type>::walk(parts[i], visit);
+  });
+}
+
+/*
+Folds map(node) over every node holding a value. Each part starts from
+identity, and the parts are folded into identity in key order, so combine
+need only be associative.
+*/
+template <class TrieT, class T, class MapT, class CombineT>
+T parallel_reduce(TrieT &trie, T identity, MapT map, CombineT combine, work_stealing_pool &pool = work_stealing_pool::shared()) {
+  typedef typename std::remove_const<TrieT>::type trie_type;
+  typedef typename std::conditional<std::is_const<TrieT>::value, typename trie_type::const_reference, typename trie_type::reference>::type reference;
+  auto parts = trie_partition<trie_type>::split(trie, pool.size());
+  /* wrapped so that parts write separate objects even where T is bool */
+  struct slot {
+    T value;
+  };
+  std::vector<slot> results(parts.size(), slot{ identity });
+  pool.run(parts.size(), [&](size_t i) {
+    T &result = results[i].value;
+    auto visit = [&](typename trie_type::pointer node) { result = combine(result, map(static_cast<reference>(*node))); };
+    trie_partition<trie_type>::walk(parts[i], visit);
+  });
+  for (auto &it : results)
+    identity = combine(identity, it.value);
+  return identity;
+}
+
+/* writes map(node) for every node holding a value to out in key order; map runs in parallel into a buffer per part */
+template <class TrieT, class MapT, class OutputIt>
+OutputIt parallel_transform(TrieT &trie, MapT map, OutputIt out, work_stealing_pool &pool = work_stealing_pool::shared()) {
+  typedef typename std::remove_const<TrieT>::type trie_type;
+  typedef typename std::conditional<std::is_const<TrieT>::value, typename trie_type::const_reference, typename trie_type::reference>::type reference;
+  typedef typename std::decay<decltype(map(std::declval<reference>()))>::type result_type;
+  auto parts = trie_partition<trie_type>::split(trie, pool.size());
+  std::vector<std::vector<result_type>> buffers(parts.size());
+  pool.run(parts.size(), [&](size_t i) {
+    auto visit = [&](typename trie_type::pointer node) { buffers[i].push_back(map(static_cast<reference>(*node))); };
+    trie_partition<trie_type>::walk(parts[i], visit);
+  });
+  for (auto &buffer : buffers)
+    out = std::move(buffer.begin(), buffer.end(), out);
+  return out;
+}
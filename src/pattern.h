@@ -0,0 +1,204 @@
+#pragma once
+
+#include "trie.h"
+
+namespace error {
+  struct invalid_pattern : std::runtime_error {
+    explicit invalid_pattern(const std::string &message) : std::runtime_error("invalid pattern: " + message) {}
+  };
+}
+
+/*
+A pattern over a trie's alphabet, compiled to a DFA whose transitions are
+alphabet indices. trie::match walks the trie and the DFA together, descending
+only into children the current DFA state can accept.
+
+Patterns match whole keys. Two syntaxes are supported:
+  glob:  ? any symbol, * any run of symbols, [abc] [a-z] [!a-z] classes, \ escapes
+  regex: . any symbol, [abc] [a-z] [^a-z] classes, \ escapes, each optionally
+         followed by *, + or ?; there are no groups or alternation
+Ranges in classes follow the alphabet's ordering.
+*/
+template <class TrieT>
+class trie_pattern {
+public:
+  typedef typename TrieT::key_type key_type;
+  typedef typename TrieT::pred_type pred_type;
+  typedef typename TrieT::alphabet_type alphabet_type;
+
+  template <class SequenceT>
+  static trie_pattern glob(const SequenceT &expr, const TrieT &trie) {
+    return trie_pattern(parse(sequence(expr), trie._alphabet, false), trie._alphabet.size());
+  }
+
+  template <class SequenceT>
+  static trie_pattern regex(const SequenceT &expr, const TrieT &trie) {
+    return trie_pattern(parse(sequence(expr), trie._alphabet, true), trie._alphabet.size());
+  }
+
+  int start() const {
+    return 0;
+  }
+
+  /* the state after the symbol at index in the alphabet, or -1 if the pattern cannot accept it */
+  int next(const int state, const int index) const {
+    return _next[state * _width + index];
+  }
+
+  bool accepting(const int state) const {
+    return _accepting[state];
+  }
+
+  /* alphabet indices, in order, that state has a transition for */
+  const std::vector<int> &candidates(const int state) const {
+    return _candidates[state];
+  }
+
+  size_t states() const {
+    return _accepting.size();
+  }
+
+private:
+  enum repeat { one, optional, many };
+
+  struct element {
+    std::vector<bool> symbols;
+    repeat count;
+  };
+
+  size_t _width;
+  std::vector<int> _next;
+  std::vector<bool> _accepting;
+  std::vector<std::vector<int>> _candidates;
+
+  trie_pattern(const std::vector<element> &elements, const size_t width) : _width(width) {
+    compile(elements);
+  }
+
+  template <class SequenceT>
+  static std::vector<key_type> sequence(const SequenceT &expr) {
+    std::vector<key_type> result;
+    for (auto first = _std::begin(expr), last = _std::end(expr); first != last; ++first)
+      result.push_back(*first);
+    return result;
+  }
+
+  static std::vector<element> parse(const std::vector<key_type> &expr, const alphabet_type &alphabet, const bool regex) {
+    std::vector<element> elements;
+    for (size_t i = 0; i < expr.size();) {
+      key_type ch = expr[i++];
+
+      if (regex && (ch == key_type('*') || ch == key_type('+') || ch == key_type('?'))) {
+        if (elements.empty() || elements.back().count != one)
+          throw error::invalid_pattern("quantifier does not follow a symbol");
+        if (ch == key_type('+'))
+          elements.push_back(elements.back());
+        elements.back().count = ch == key_type('?') ? optional : many;
+        continue;
+      }
+
+      element e = { std::vector<bool>(alphabet.size()), one };
+      if (!regex && ch == key_type('*')) {
+        e.symbols.assign(alphabet.size(), true);
+        e.count = many;
+      } else if (ch == key_type(regex ? '.' : '?')) {
+        e.symbols.assign(alphabet.size(), true);
+      } else if (ch == key_type('[')) {
+        i = parse_class(expr, i, alphabet, regex, e.symbols);
+      } else {
+        if (ch == key_type('\\'))
+          ch = escaped(expr, i++);
+        add_range(alphabet, ch, ch, e.symbols);
+      }
+      elements.push_back(e);
+    }
+    return elements;
+  }
+
+  /* parses a class starting after its '[' and returns the position after its ']' */
+  static size_t parse_class(const std::vector<key_type> &expr, size_t i, const alphabet_type &alphabet, const bool regex, std::vector<bool> &symbols) {
+    bool negate = i < expr.size() && (expr[i] == key_type('^') || (!regex && expr[i] == key_type('!')));
+    if (negate)
+      ++i;
+
+    for (size_t first = i; i < expr.size() && (i == first || expr[i] != key_type(']'));) {
+      key_type low = expr[i] == key_type('\\') ? escaped(expr, ++i) : expr[i];
+      key_type high = low;
+      if (i + 2 < expr.size() && expr[i + 1] == key_type('-') && expr[i + 2] != key_type(']')) {
+        i += 2;
+        high = expr[i] == key_type('\\') ? escaped(expr, ++i) : expr[i];
+      }
+      ++i;
+      add_range(alphabet, low, high, symbols);
+    }
+
+    if (i >= expr.size())
+      throw error::invalid_pattern("unterminated character class");
+    if (negate)
+      symbols.flip();
+    return i + 1;
+  }
+
+  static key_type escaped(const std::vector<key_type> &expr, const size_t i) {
+    if (i >= expr.size())
+      throw error::invalid_pattern("escape at end of pattern");
+    return expr[i];
+  }
+
+  static void add_range(const alphabet_type &alphabet, const key_type &low, const key_type &high, std::vector<bool> &symbols) {
+    pred_type less;
+    for (size_t k = 0; k < alphabet.size(); ++k) {
+      key_type symbol = alphabet.value_of(int(k));
+      if (!less(symbol, low) && !less(high, symbol))
+        symbols[k] = true;
+    }
+  }
+
+  /*
+  Subset construction over NFA positions: position i means the first i elements
+  are matched. An optional or repeated element may be skipped, and a repeated
+  element stays at its position after matching a symbol.
+  */
+  void compile(const std::vector<element> &elements) {
+    const size_t n = elements.size();
+    std::map<std::vector<bool>, int> ids;
+    std::vector<std::vector<bool>> sets;
+
+    auto state_of = [&](std::vector<bool> &set) {
+      for (size_t i = 0; i < n; ++i)
+        if (set[i] && elements[i].count != one)
+          set[i + 1] = true;
+      auto it = ids.find(set);
+      if (it != ids.end())
+        return it->second;
+      ids[set] = int(sets.size());
+      sets.push_back(set);
+      return int(sets.size()) - 1;
+    };
+
+    std::vector<bool> initial(n + 1);
+    initial[0] = true;
+    state_of(initial);
+
+    for (size_t state = 0; state < sets.size(); ++state) {
+      const std::vector<bool> current = sets[state];
+      _accepting.push_back(current[n]);
+      _candidates.push_back(std::vector<int>());
+
+      for (size_t k = 0; k < _width; ++k) {
+        std::vector<bool> next(n + 1);
+        bool live = false;
+        for (size_t i = 0; i < n; ++i)
+          if (current[i] && elements[i].symbols[k]) {
+            next[elements[i].count == many ? i : i + 1] = true;
+            live = true;
+          }
+
+        int target = live ? state_of(next) : -1;
+        _next.push_back(target);
+        if (target >= 0)
+          _candidates.back().push_back(int(k));
+      }
+    }
+  }
+};
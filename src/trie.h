@@ -2,39 +2,92 @@
 
 namespace error {
   struct not_in_alphabet : std::runtime_error {
-    explicit not_in_alphabet(const char ch) : std::runtime_error("character not in alphabet: " + ch) {}
-    explicit not_in_alphabet(const wchar_t ch) : std::runtime_error("character not in alphabet: " + ch) {}
-    explicit not_in_alphabet(const int index) : std::runtime_error("index not in alphabet: " + index) {}
+    explicit not_in_alphabet(const char ch) : std::runtime_error(std::string("character not in alphabet: ") + ch) {}
+    explicit not_in_alphabet(const wchar_t ch) : std::runtime_error("character not in alphabet: " + std::to_string(static_cast<long>(ch))) {}
+    explicit not_in_alphabet(const int index) : std::runtime_error("index not in alphabet: " + std::to_string(index)) {}
   };
 
   struct invalid_alphabet_sequence : std::runtime_error {
     explicit invalid_alphabet_sequence(const std::string type) : std::runtime_error("alphabet contains more elements than '" + type + "' can support") {}
   };
 
+  struct alphabet_mismatch : std::runtime_error {
+    explicit alphabet_mismatch(const std::string &operation) : std::runtime_error("tries have different alphabets: " + operation) {}
+  };
+
   struct null_iterator : std::runtime_error {
     explicit null_iterator(const std::string &message) : std::runtime_error("operation performed on null trie iterator: " + message) {}
   };
+
+  struct key_not_found : std::out_of_range {
+    key_not_found() : std::out_of_range("key not found in trie") {}
+  };
 }
 
 /* until c++17 */
 namespace _std {
 
+  /* end of a null-terminated sequence, found while iterating rather than with strlen */
+  struct null_terminator {};
+
+  template <class CharT>
+  inline bool operator!=(const CharT *it, null_terminator) {
+    return *it != CharT();
+  }
+
+  template <class T>
+  inline auto begin(const T &seq) -> decltype(seq.begin()) {
+    return seq.begin();
+  }
+
   template <class T>
-  inline auto size(const T &seq) -> decltype(seq.size()) {
-    return seq.size();
+  inline auto end(const T &seq) -> decltype(seq.end()) {
+    return seq.end();
+  }
+
+  template <class T, size_t N>
+  inline const T *begin(const T(&arr)[N]) {
+    return arr;
   }
 
   template <class T, size_t N>
-  inline size_t size(const T(&arr)[N]) {
-    return N;
+  inline const T *end(const T(&arr)[N]) {
+    return arr + N;
+  }
+
+  inline const char *begin(const char *arr) {
+    return arr;
+  }
+
+  inline null_terminator end(const char *) {
+    return null_terminator();
+  }
+
+  inline const wchar_t *begin(const wchar_t *arr) {
+    return arr;
+  }
+
+  inline null_terminator end(const wchar_t *) {
+    return null_terminator();
+  }
+
+  /* until c++20 */
+
+  inline int popcount(unsigned long long x) {
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return int((x * 0x0101010101010101ull) >> 56);
   }
 
-  inline size_t size(const char *arr) {
-    return strlen(arr);
+  inline int countr_zero(unsigned long long x) {
+    return x ? popcount((x & (0 - x)) - 1) : 64;
   }
 
-  inline size_t size(const wchar_t *arr) {
-    return wcslen(arr);
+  inline int countl_zero(unsigned long long x) {
+    for (int shift = 1; shift < 64; shift <<= 1)
+      x |= x >> shift;
+    return 64 - popcount(x);
   }
 
 }
@@ -51,6 +104,7 @@ private:
   compare_type _compare;
   sequence_type _alpha;
   const_iterator _begin, _end;
+  std::vector<int> _lookup;
 
 public:
 
@@ -68,13 +122,20 @@ public:
     std::sort(_alpha.begin(), _alpha.end(), _compare);
     _begin = _alpha.begin();
     _end = _alpha.end();
+
+    /* single byte symbols are looked up in a table instead of searched for */
+    if (sizeof(key_type) == 1)
+      for (int i = 0; i < 256; ++i)
+        _lookup.push_back(binary_search(0, _alpha.size(), key_type(i)));
   }
 
-  int index_of(const key_type &ch) {
+  int index_of(const key_type &ch) const {
+    if (!_lookup.empty())
+      return _lookup[static_cast<unsigned char>(ch)];
     return binary_search(0, _alpha.size(), ch);
   }
 
-  key_type value_of(const int index) {
+  key_type value_of(const int index) const {
     if (index < 0 || index > _alpha.size())
       throw error::not_in_alphabet(index);
     return _alpha[index];
@@ -84,9 +145,17 @@ public:
     return _alpha.size();
   }
 
+  friend bool operator==(const alphabet &left, const alphabet &right) {
+    return left._alpha == right._alpha;
+  }
+
+  friend bool operator!=(const alphabet &left, const alphabet &right) {
+    return !(left == right);
+  }
+
 private:
 
-  int binary_search(size_t min, size_t max, const key_type &ch) {
+  int binary_search(size_t min, size_t max, const key_type &ch) const {
     if (min >= max)
       return -1;
     size_t mid = (min + max) / 2;
@@ -99,10 +168,333 @@ private:
 
 };
 
-template <class KeyT, class ElemT, class PredT = std::less<KeyT>>
+/*
+Child pointers of a trie_node, kept in alphabet order. Alphabets of up to
+dense_limit symbols get a slot per symbol. Larger ones, such as wchar_t or byte
+alphabets, only store the children present: a sorted list of 64-symbol
+blocks, each with a bitmap of the symbols it holds, indexes a compact array
+of children by popcount. Both live in one allocation, resized as children
+are added or removed.
+
+The alphabet size is passed in rather than stored, as every node of a trie
+shares it.
+*/
+template <class NodeT>
+class trie_children {
+public:
+  /*
+  A dense table costs a pointer per symbol for every node with a child, up to
+  512 bytes on 64-bit even where a single child is present, but finds a child
+  with one load. A sparse table costs a block search and a popcount instead.
+  With the 62-symbol alphabet, dense tables take about five times the memory
+  (Heavy_Insert) but halve lookups through well-filled top levels
+  (Heavy_Retrieval_Prefixes). Where most nodes hold few children, sparse
+  tables win on insert, memory and lookup alike (Wide_Insert at the limit).
+  */
+  static const size_t dense_limit = 64;
+
+  trie_children() : _children(nullptr), _blocks(nullptr), _count(0), _block_count(0) {}
+
+  NodeT *get(const int index, const size_t width) const {
+    if (!_children)
+      return nullptr;
+    if (!sparse(width))
+      return _children[index];
+    const block *b = find_block(index);
+    unsigned long long bit = 1ull << (index & 63);
+    return b && (b->bits & bit) ? _children[b->rank + _std::popcount(b->bits & (bit - 1))] : nullptr;
+  }
+
+  /* index must not already have a child */
+  void set(const int index, NodeT *node, const size_t width) {
+    if (!sparse(width)) {
+      if (!_children) {
+        _children = new NodeT*[width];
+        for (size_t i = 0; i < width; ++i)
+          _children[i] = nullptr;
+      }
+      _children[index] = node;
+      ++_count;
+      return;
+    }
+
+    const unsigned base = unsigned(index >> 6);
+    const unsigned long long bit = 1ull << (index & 63);
+    block *b = std::lower_bound(_blocks, _blocks + _block_count, base, before);
+    const size_t at = b - _blocks;
+    const bool found = at < _block_count && b->base == base;
+    const size_t child = found ? b->rank + _std::popcount(b->bits & (bit - 1)) : at < _block_count ? b->rank : _count;
+
+    const unsigned block_count = _block_count + (found ? 0 : 1);
+    block *blocks = allocate(block_count, _count + 1);
+    NodeT **children = reinterpret_cast<NodeT **>(blocks + block_count);
+
+    std::copy(_blocks, _blocks + at, blocks);
+    std::copy(_blocks + at, _blocks + _block_count, blocks + block_count - (_block_count - at));
+    if (!found) {
+      block added = { base, unsigned(child), 0 };
+      blocks[at] = added;
+    }
+    blocks[at].bits |= bit;
+    for (size_t i = at + 1; i < block_count; ++i)
+      ++blocks[i].rank;
+
+    std::copy(_children, _children + child, children);
+    children[child] = node;
+    std::copy(_children + child, _children + _count, children + child + 1);
+
+    replace(blocks, children, block_count, _count + 1);
+  }
+
+  /* puts node in place of the child at index, which must exist, and returns the child */
+  NodeT *exchange(const int index, NodeT *node, const size_t width) {
+    NodeT **slot = _children + index;
+    if (sparse(width)) {
+      const block *b = find_block(index);
+      slot = _children + b->rank + _std::popcount(b->bits & ((1ull << (index & 63)) - 1));
+    }
+    NodeT *old = *slot;
+    *slot = node;
+    return old;
+  }
+
+  /* forgets the child at index without deleting it */
+  void reset(const int index, const size_t width) {
+    if (_count == 1) {
+      release();
+      return;
+    }
+    if (!sparse(width)) {
+      _children[index] = nullptr;
+      --_count;
+      return;
+    }
+
+    const unsigned long long bit = 1ull << (index & 63);
+    block *b = find_block(index);
+    const size_t at = b - _blocks;
+    const size_t child = b->rank + _std::popcount(b->bits & (bit - 1));
+    const bool emptied = b->bits == bit;
+
+    const unsigned block_count = _block_count - (emptied ? 1 : 0);
+    block *blocks = allocate(block_count, _count - 1);
+    NodeT **children = reinterpret_cast<NodeT **>(blocks + block_count);
+
+    std::copy(_blocks, _blocks + at, blocks);
+    std::copy(_blocks + at + (emptied ? 1 : 0), _blocks + _block_count, blocks + at);
+    if (!emptied)
+      blocks[at].bits &= ~bit;
+    for (size_t i = emptied ? at : at + 1; i < block_count; ++i)
+      --blocks[i].rank;
+
+    std::copy(_children, _children + child, children);
+    std::copy(_children + child + 1, _children + _count, children + child);
+
+    replace(blocks, children, block_count, _count - 1);
+  }
+
+  /* the lowest index at or after start with a child, or -1 */
+  int next(int start, const size_t width) const {
+    if (!_children)
+      return -1;
+    if (start < 0)
+      start = 0;
+    if (!sparse(width)) {
+      for (; start < int(width); ++start)
+        if (_children[start])
+          return start;
+      return -1;
+    }
+
+    const block *b = std::lower_bound(_blocks, _blocks + _block_count, unsigned(start >> 6), before);
+    if (b == _blocks + _block_count)
+      return -1;
+    unsigned long long bits = b->bits;
+    if (b->base == unsigned(start >> 6) && !((bits &= ~0ull << (start & 63)))) {
+      if (++b == _blocks + _block_count)
+        return -1;
+      bits = b->bits;
+    }
+    return int(b->base << 6) + _std::countr_zero(bits);
+  }
+
+  /* the highest index at or before start with a child, or -1 */
+  int prev(int start, const size_t width) const {
+    if (!_children || start < 0)
+      return -1;
+    if (start >= int(width))
+      start = int(width) - 1;
+    if (!sparse(width)) {
+      for (; start >= 0; --start)
+        if (_children[start])
+          return start;
+      return -1;
+    }
+
+    const block *b = std::upper_bound(_blocks, _blocks + _block_count, unsigned(start >> 6), after);
+    if (b == _blocks)
+      return -1;
+    unsigned long long bits = (--b)->bits;
+    if (b->base == unsigned(start >> 6) && !((bits &= ~0ull >> (63 - (start & 63))))) {
+      if (b == _blocks)
+        return -1;
+      bits = (--b)->bits;
+    }
+    return int(b->base << 6) + 63 - _std::countl_zero(bits);
+  }
+
+  size_t size() const {
+    return _count;
+  }
+
+  bool empty() const {
+    return !_count;
+  }
+
+  /* frees the table, not the children */
+  void release() {
+    if (_blocks)
+      delete[] _blocks;
+    else
+      delete[] _children;
+    forget();
+  }
+
+  static bool sparse(const size_t width) {
+    return width > dense_limit;
+  }
+
+  /* the size of the table, for placing a copy of it elsewhere */
+  size_t bytes(const size_t width) const {
+    if (!_children)
+      return 0;
+    if (!sparse(width))
+      return width * sizeof(NodeT *);
+    return (_block_count + (_count * sizeof(NodeT *) + sizeof(block) - 1) / sizeof(block)) * sizeof(block);
+  }
+
+  /*
+  Copies the table into storage of bytes(width) and uses that copy from now
+  on, passing every child through map. The old table is not freed.
+  */
+  template <class MapT>
+  void place(void *storage, const size_t width, MapT map) {
+    if (!_children)
+      return;
+    if (!sparse(width)) {
+      NodeT **children = static_cast<NodeT **>(storage);
+      for (size_t i = 0; i < width; ++i)
+        children[i] = _children[i] ? map(_children[i]) : nullptr;
+      _children = children;
+      return;
+    }
+    block *blocks = static_cast<block *>(storage);
+    NodeT **children = reinterpret_cast<NodeT **>(blocks + _block_count);
+    std::copy(_blocks, _blocks + _block_count, blocks);
+    for (size_t i = 0; i < _count; ++i)
+      children[i] = map(_children[i]);
+    _blocks = blocks;
+    _children = children;
+  }
+
+  /* moves a table held in someone else's storage to one of its own */
+  void own(const size_t width) {
+    if (_children)
+      place(sparse(width) ? static_cast<void *>(allocate(_block_count, _count)) : new NodeT*[width], width, [](NodeT *node) { return node; });
+  }
+
+  /* empties the table without freeing it, as its storage is someone else's */
+  void forget() {
+    _children = nullptr;
+    _blocks = nullptr;
+    _count = 0;
+    _block_count = 0;
+  }
+
+private:
+  struct block {
+    unsigned base, rank;
+    unsigned long long bits;
+  };
+
+  NodeT **_children;
+  block *_blocks;
+  unsigned _count, _block_count;
+
+  static bool before(const block &b, const unsigned base) {
+    return b.base < base;
+  }
+
+  static bool after(const unsigned base, const block &b) {
+    return base < b.base;
+  }
+
+  block *find_block(const int index) const {
+    block *b = std::lower_bound(_blocks, _blocks + _block_count, unsigned(index >> 6), before);
+    return b != _blocks + _block_count && b->base == unsigned(index >> 6) ? b : nullptr;
+  }
+
+  /* one allocation holding the blocks followed by the children they index */
+  static block *allocate(const size_t block_count, const size_t count) {
+    return new block[block_count + (count * sizeof(NodeT *) + sizeof(block) - 1) / sizeof(block)];
+  }
+
+  void replace(block *blocks, NodeT **children, const unsigned block_count, const unsigned count) {
+    delete[] _blocks;
+    _blocks = blocks;
+    _children = children;
+    _block_count = block_count;
+    _count = count;
+  }
+};
+
+enum class trie_operation { insert, find, erase };
+
+/*
+The default instrumentation policy of a trie, which records nothing. A
+policy is a type with these static hooks (see trie_stats.h for one that
+counts); as they are empty and inline here, an uninstrumented trie pays
+nothing for them.
+*/
+struct no_stats {
+  /* lives for the duration of an operation, to time it */
+  struct scope {
+    explicit scope(trie_operation) {}
+  };
+
+  static void found(bool) {}
+  static void step() {}
+  static void node_allocated() {}
+  static void node_freed() {}
+  static void index_lookup() {}
+  static void traversed(size_t) {}
+};
+
+template <class KeyT, class ElemT, class PredT = std::less<KeyT>, class StatsT = no_stats>
 class trie;
 
-template <class KeyT, class ElemT, class PredT = std::less<KeyT>>
+template <class TrieT>
+class trie_cursor;
+
+template <class TrieT>
+class aho_corasick;
+
+template <class TrieT>
+class trie_pattern;
+
+template <class KeyT, class PredT>
+class dawg;
+
+template <class TrieT>
+class trie_cache;
+
+template <class TrieT>
+class durable_trie;
+
+template <class TrieT>
+class trie_partition;
+
+template <class KeyT, class ElemT, class PredT = std::less<KeyT>, class StatsT = no_stats>
 class trie_node {
 public:
   typedef KeyT key_type;
@@ -110,90 +502,211 @@ public:
   typedef PredT pred_type;
   typedef alphabet<key_type, pred_type> alphabet_type;
   typedef std::pair<bool, mapped_type> value_type;
-  typedef trie_node<key_type, mapped_type, pred_type> self;
+  typedef StatsT stats_type;
+  typedef trie_node<key_type, mapped_type, pred_type, stats_type> self;
+  typedef trie<key_type, mapped_type, pred_type, stats_type> trie_type;
 
-  friend trie<key_type, mapped_type, pred_type>;
+  friend trie_type;
+  friend trie_cursor<trie_type>;
+  friend aho_corasick<trie_type>;
+  friend trie_cache<trie_type>;
+  friend durable_trie<trie_type>;
+  friend trie_partition<trie_type>;
 
 private:
   value_type _value;
   key_type _key;
-  self **_nodes;
+  /* whether the node, or its child table, lives in a region laid out by trie::compact */
+  bool _pooled, _pooled_children;
+  trie_children<self> _nodes;
   self *_parent;
   alphabet_type *_alphabet;
 
 public:
 
   self *successor() {
+    return const_cast<self *>(static_cast<const self *>(this)->successor());
+  }
+
+  const self *successor() const {
     return successor(0);
   }
 
   self *predecessor() {
-    return predecessor(int(_alphabet->size()) - 1);
+    return const_cast<self *>(static_cast<const self *>(this)->predecessor());
+  }
+
+  const self *predecessor() const {
+    if (!_parent) {
+      const self *node = last();
+      return node ? node : this;
+    }
+    for (int index = _parent->prev_child(index_of(_key) - 1); index >= 0; index = _parent->prev_child(index - 1))
+      if (const self *node = static_cast<const self *>(_parent->child(index))->last())
+        return node;
+    return _parent->active() || !_parent->_parent
+      ? _parent
+      : _parent->predecessor();
   }
 
   template <class SequenceT>
-  SequenceT key() {
+  SequenceT key() const {
     SequenceT key;
-    self *next = this;
-    while (next->_parent) {
-      key.insert(key.begin(), next->_key);
-      next = next->_parent;
+    key.resize(depth());
+    auto it = key.rbegin();
+    for (const self *next = this; next->_parent; next = next->_parent)
+      *it++ = next->_key;
+    return key;
+  }
+
+  /*
+  Writes the key into buffer without allocating and returns its length.
+  Nothing is written if the key is longer than capacity.
+  */
+  size_t key_into(key_type *buffer, size_t capacity) const {
+    size_t length = depth();
+    if (length <= capacity) {
+      size_t i = length;
+      for (const self *next = this; next->_parent; next = next->_parent)
+        buffer[--i] = next->_key;
     }
-    return std::move(key);
+    return length;
+  }
+
+  size_t depth() const {
+    size_t x(0);
+    for (const self *next = this; next->_parent; next = next->_parent)
+      ++x;
+    return x;
   }
 
   mapped_type &value() {
     return _value.second;
   }
 
+  const mapped_type &value() const {
+    return _value.second;
+  }
+
 protected:
 
-  trie_node() : _nodes(nullptr), _parent(nullptr), _alphabet(nullptr) {}
+  trie_node() : _pooled(false), _pooled_children(false), _parent(nullptr), _alphabet(nullptr) {}
 
   ~trie_node() {
-    if (_nodes) {
-      for (int i = 0; i < _alphabet->size(); ++i)
-        delete _nodes[i];
-      delete[] _nodes;
-    }
+    clear();
   }
 
-  template <class SequenceT>
-  mapped_type &operator[](const SequenceT &key) {
-    self *node = traverse_and_create(key);
+  /* deletes the subtree below this node and its value, and returns how many values there were */
+  size_t clear() {
+    size_t x(0);
+    clear(x);
+    return x;
+  }
+
+  template <class IterT, class EndT>
+  mapped_type &get(IterT first, EndT last) {
+    self *node = traverse_and_create(first, last);
     node->_value.first = true;
     return node->_value.second;
   }
 
-  template <class SequenceT>
-  self *find(const SequenceT &key) {
-    return traverse(key);
+  template <class IterT, class EndT>
+  std::pair<self *, bool> insert(IterT first, EndT last, const mapped_type &value) {
+    self *node = traverse_and_create(first, last);
+    if (node->_value.first)
+      return std::make_pair(node, false);
+    node->_value = value_type(true, value);
+    return std::make_pair(node, true);
   }
 
-  template <class SequenceT>
-  bool has(const SequenceT &key) {
-    self *node = traverse(key);
-    return node ? node->_value.first : false;
+  template <class IterT, class EndT>
+  self *find(IterT first, EndT last) {
+    return const_cast<self *>(static_cast<const self *>(this)->find(first, last));
   }
 
-  template <class SequenceT>
-  bool remove(const SequenceT &key) {
-    self *node = traverse(key);
-    if (!node)
-      return false;
+  /* never allocates or throws: a symbol outside the alphabet is a miss */
+  template <class IterT, class EndT>
+  const self *find(IterT first, EndT last) const {
+    const self *node = this;
+    size_t depth = 0;
+    for (; first != last; ++first, ++depth)
+      if (!((node = node->find_child(*first))))
+        break;
+    stats_type::traversed(depth);
+    return node;
+  }
 
-    node->_value = value_type();
+  template <class IterT, class EndT>
+  bool has(IterT first, EndT last) const {
+    const self *node = find(first, last);
+    return node ? node->_value.first : false;
+  }
 
-    for (int i = _std::size(key) - 1; i >= 0; --i) {
-      node = node->_parent;
-      if (!node || !node->prune(index_of(key[i])))
+  /* visits every node along key that holds a value, shortest first */
+  template <class IterT, class EndT, class VisitT>
+  void prefixes(IterT first, EndT last, VisitT visit) {
+    self *node = this;
+    while (true) {
+      if (node->_value.first)
+        visit(node);
+      if (!(first != last) || !((node = node->find_child(*first))))
         break;
+      ++first;
+    }
+  }
+
+  /*
+  Visits every node holding a value whose key takes pattern from state to an
+  accepting state. Whichever is smaller, the node's children or the state's
+  candidate symbols, is walked and looked up in the other.
+  */
+  template <class PatternT, class VisitT>
+  void match(const PatternT &pattern, int state, VisitT &visit) {
+    if (_value.first && pattern.accepting(state))
+      visit(this);
+    if (_nodes.empty())
+      return;
+    const auto &candidates = pattern.candidates(state);
+    if (_nodes.size() < candidates.size()) {
+      for (int i = next_child(0); i >= 0; i = next_child(i + 1)) {
+        int next = pattern.next(state, i);
+        if (next >= 0)
+          child(i)->match(pattern, next, visit);
+      }
+    } else {
+      for (auto index : candidates)
+        if (self *node = child(index))
+          node->match(pattern, pattern.next(state, index), visit);
     }
+  }
+
+  template <class IterT, class EndT>
+  bool remove(IterT first, EndT last) {
+    self *node = traverse(first, last);
+    if (!node)
+      return false;
+    node->erase();
     return true;
   }
 
+  /* like remove, but erases every key starting with the given prefix */
+  template <class IterT, class EndT>
+  size_t remove_prefix(IterT first, EndT last) {
+    self *node = traverse(first, last);
+    if (!node)
+      return 0;
+    size_t x = node->clear();
+    node->prune_upwards();
+    return x;
+  }
+
   void erase() {
     _value = value_type();
+    prune_upwards();
+  }
+
+  /* deletes this node and its ancestors while they hold nothing */
+  void prune_upwards() {
     self *next = this;
     while (next->_parent) {
       auto index = next->index_of(next->_key);
@@ -206,147 +719,293 @@ protected:
   void size(size_t &x) const {
     if (_value.first)
       ++x;
-    if (_nodes)
-      for (int i = 0; i < _alphabet->size(); ++i)
-        if (_nodes[i])
-          _nodes[i]->size(x);
+    for (int i = next_child(0); i >= 0; i = next_child(i + 1))
+      child(i)->size(x);
   }
 
-private:
+  /*
+  Visits every node within max_distance edits of query, given as alphabet indices.
+  rows holds one Levenshtein row per depth; a child's row is computed from its
+  parent's, and subtrees whose row minimum exceeds max_distance are skipped.
+  */
+  template <class VisitT>
+  void fuzzy(const std::vector<int> &query, std::vector<size_t> &rows, size_t depth, size_t max_distance, VisitT &visit) {
+    if (_nodes.empty())
+      return;
+    const size_t width = query.size() + 1;
+    if (rows.size() < (depth + 2) * width)
+      rows.resize((depth + 2) * width);
+
+    for (int i = next_child(0); i >= 0; i = next_child(i + 1)) {
+      self *node = child(i);
+      const size_t *prev = &rows[depth * width];
+      size_t *row = &rows[(depth + 1) * width];
+      row[0] = prev[0] + 1;
+      size_t minimum = row[0];
+      for (size_t j = 1; j < width; ++j) {
+        row[j] = (std::min)((std::min)(prev[j], row[j - 1]) + 1, prev[j - 1] + (query[j - 1] == i ? 0 : 1));
+        minimum = (std::min)(minimum, row[j]);
+      }
+      if (node->_value.first && row[width - 1] <= max_distance)
+        visit(node, row[width - 1]);
+      if (minimum <= max_distance)
+        node->fuzzy(query, rows, depth + 1, max_distance, visit);
+    }
+  }
 
-  trie_node(const key_type &key, self *parent, alphabet_type *alphabet)
-    : _key(key), _parent(parent), _alphabet(alphabet) {}
+  /*
+  The set operations below walk two tries of the same alphabet in lockstep,
+  child index by child index. Subtrees present on only one side are never
+  copied: a moved subtree is relinked in one pass that points each of its
+  nodes at its new parent and alphabet, and the others are freed or skipped.
+  */
 
-  self *predecessor(int start) {
-    self *node;
-    if (!((node = predecessor_in_children(start))))
-      if (!((node = predecessor_in_parent())))
-        node = root();
-    return node;
+  /* moves every key of other into this subtree, leaving other empty */
+  template <class CombineT>
+  void merge(self *other, CombineT &combine) {
+    if (other->_value.first) {
+      if (_value.first)
+        _value.second = combine(_value.second, other->_value.second);
+      else
+        _value = std::move(other->_value);
+      other->_value = value_type();
+    }
+    for (int i = other->next_child(0); i >= 0; i = other->next_child(i + 1)) {
+      self *theirs = other->child(i);
+      if (self *mine = child(i)) {
+        mine->merge(theirs, combine);
+        destroy(theirs);
+      } else {
+        theirs->adopt(this);
+        own_children();
+        _nodes.set(i, theirs, _alphabet->size());
+      }
+    }
+    other->release_children();
   }
 
-  self *predecessor_in_children(int start) {
-    if (!_nodes)
-      return nullptr;
+  /* keeps only the keys also in other */
+  template <class CombineT>
+  void intersect(const self *other, CombineT &combine) {
+    if (_value.first) {
+      if (other->_value.first)
+        _value.second = combine(_value.second, other->_value.second);
+      else
+        _value = value_type();
+    }
+    for (int i = next_child(0); i >= 0; i = next_child(i + 1)) {
+      self *mine = child(i);
+      const self *theirs = other->child(i);
+      if (theirs)
+        mine->intersect(theirs, combine);
+      if (!theirs || should_prune(mine))
+        detach(i);
+    }
+  }
+
+  /* removes the keys that are in other */
+  void difference(const self *other) {
+    if (other->_value.first)
+      _value = value_type();
+    for (int i = next_child(0); i >= 0;) {
+      int j = other->next_child(i);
+      if (j < 0)
+        break;
+      if (j != i) {
+        i = next_child(j);
+        continue;
+      }
+      self *mine = child(i);
+      mine->difference(other->child(i));
+      if (should_prune(mine))
+        detach(i);
+      i = next_child(i + 1);
+    }
+  }
 
-    while (start >= 0 && _nodes[start] == nullptr)
-      --start;
+private:
 
-    if (start < 0)
-      return nullptr;
+  trie_node(const key_type &key, self *parent, alphabet_type *alphabet)
+    : _key(key), _pooled(false), _pooled_children(false), _parent(parent), _alphabet(alphabet) {}
+
+  void clear(size_t &x) {
+    if (_value.first)
+      ++x;
+    _value = value_type();
+    if (!_nodes.empty())
+      for (int i = next_child(0); i >= 0; i = next_child(i + 1)) {
+        child(i)->clear(x);
+        destroy(child(i));
+      }
+    release_children();
+  }
 
-    return _nodes[start]->active()
-      ? _nodes[start]
-      : _nodes[start]->predecessor();
+  self *last() {
+    return const_cast<self *>(static_cast<const self *>(this)->last());
   }
 
-  self *predecessor_in_parent() {
-    return _parent ? _parent->predecessor(index_of(_key) - 1) : nullptr;
+  /* the last node of this subtree holding a value in key order, or null if none does */
+  const self *last() const {
+    if (!_nodes.empty())
+      for (int index = prev_child(int(_alphabet->size()) - 1); index >= 0; index = prev_child(index - 1))
+        if (const self *node = static_cast<const self *>(child(index))->last())
+          return node;
+    return active() ? this : nullptr;
   }
 
-  self *successor(int start) {
-    self *node;
+  const self *successor(int start) const {
+    const self *node;
     if (!((node = successor_in_children(start))))
       if (!((node = successor_in_parent())))
         node = root();
     return node;
   }
 
-  self *successor_in_children(int start) {
-    if (!_nodes)
-      return nullptr;
-
-    while (start < _alphabet->size() && _nodes[start] == nullptr)
-      ++start;
-
-    if (start >= _alphabet->size())
+  const self *successor_in_children(int start) const {
+    if ((start = next_child(start)) < 0)
       return nullptr;
 
-    return _nodes[start]->active()
-      ? _nodes[start]
-      : _nodes[start]->successor();
+    const self *node = child(start);
+    return node->active()
+      ? node
+      : node->successor();
   }
 
-  self *successor_in_parent() {
+  const self *successor_in_parent() const {
     return _parent ? _parent->successor(index_of(_key) + 1) : nullptr;
   }
 
-  self *root() {
-    return _parent ? _parent->root() : this;
+  const self *root() const {
+    return _parent ? static_cast<const self *>(_parent)->root() : this;
   }
 
-  int index_of(const key_type &key) {
+  int index_of(const key_type &key) const {
+    stats_type::index_lookup();
     auto index = _alphabet->index_of(key);
     if (index < 0)
       throw error::not_in_alphabet(key);
     return index;
   }
 
-  template <class SequenceT>
-  self *traverse(const SequenceT &key) {
+  template <class IterT, class EndT>
+  self *traverse(IterT first, EndT last) {
     self *node = this;
-    for (size_t i = 0, size = _std::size(key); i < size; ++i)
-      if (!((node = node->get_node(key[i]))))
-        return nullptr;
+    size_t depth = 0;
+    for (; first != last; ++first, ++depth)
+      if (!((node = node->get_node(*first))))
+        break;
+    stats_type::traversed(depth);
     return node;
   }
 
+  self *child(const int index) const {
+    return _nodes.get(index, _alphabet->size());
+  }
+
+  int next_child(const int start) const {
+    return _nodes.next(start, _alphabet->size());
+  }
+
+  int prev_child(const int start) const {
+    return _nodes.prev(start, _alphabet->size());
+  }
+
   self *get_node(const key_type &key) {
-    return _nodes ? _nodes[index_of(key)] : nullptr;
+    return _nodes.empty() ? nullptr : child(index_of(key));
   }
 
-  template <class SequenceT>
-  self *traverse_and_create(const SequenceT &key) {
+  /* like get_node, but a symbol outside the alphabet is simply a miss */
+  self *find_child(const key_type &key) const {
+    if (_nodes.empty())
+      return nullptr;
+    stats_type::index_lookup();
+    auto index = _alphabet->index_of(key);
+    return index < 0 ? nullptr : child(index);
+  }
+
+  template <class IterT, class EndT>
+  self *traverse_and_create(IterT first, EndT last) {
     self *next = this;
-    for (size_t i = 0, size = _std::size(key); i < size; ++i)
-      next = next->get_or_create_node(key[i]);
+    size_t depth = 0;
+    try {
+      for (; first != last; ++first, ++depth)
+        next = next->get_or_create_node(*first);
+    } catch (...) {
+      /* a symbol outside the alphabet must not leave the nodes before it behind */
+      next->prune_upwards();
+      throw;
+    }
+    stats_type::traversed(depth);
     return next;
   }
 
   self *get_or_create_node(const key_type &key) {
-    init_nodes();
-    self **node = &(_nodes[index_of(key)]);
-    if (!*node)
-      *node = new self(key, this, _alphabet);
-    return *node;
-  }
-
-  void init_nodes() {
-    if (!_nodes) {
-      auto size = _alphabet->size();
-      _nodes = new self*[size];
-      for (int i = 0; i < size; ++i)
-        _nodes[i] = nullptr;
+    auto index = index_of(key);
+    self *node = child(index);
+    if (!node) {
+      own_children();
+      _nodes.set(index, node = new self(key, this, _alphabet), _alphabet->size());
+      stats_type::node_allocated();
     }
+    return node;
   }
 
   bool prune(const int key) {
-    if (is_pruned(key))
+    self *node = child(key);
+    if (!node)
       return true;
-    if (!should_prune(_nodes[key]))
+    if (!should_prune(node))
       return false;
-    delete _nodes[key];
-    _nodes[key] = nullptr;
+    destroy(node);
+    own_children();
+    _nodes.reset(key, _alphabet->size());
     return true;
   }
 
-  bool is_pruned(const int key) {
-    return !_nodes || !_nodes[key];
+  /* deletes the child at index and its subtree */
+  void detach(const int index) {
+    destroy(child(index));
+    own_children();
+    _nodes.reset(index, _alphabet->size());
+  }
+
+  static void destroy(self *node) {
+    stats_type::node_freed();
+    if (node->_pooled)
+      node->~trie_node();
+    else
+      delete node;
+  }
+
+  /* a table in a compacted region is copied out before it changes */
+  void own_children() {
+    if (_pooled_children) {
+      _nodes.own(_alphabet->size());
+      _pooled_children = false;
+    }
+  }
+
+  void release_children() {
+    if (_pooled_children)
+      _nodes.forget();
+    else
+      _nodes.release();
+    _pooled_children = false;
+  }
+
+  /* reparents a subtree taken from another trie, which has its own alphabet */
+  void adopt(self *parent) {
+    _parent = parent;
+    _alphabet = parent->_alphabet;
+    for (int i = next_child(0); i >= 0; i = next_child(i + 1))
+      child(i)->adopt(this);
   }
 
   bool should_prune(self *node) {
-    if (!node)
-      return true;
-    if (node->_value.first)
-      return false;
-    if (node->_nodes)
-      for (int i = 0; i < _alphabet->size(); ++i)
-        if (node->_nodes[i])
-          return false;
-    return true;
+    return !node || (!node->_value.first && node->_nodes.empty());
   }
 
-  bool active() {
+  bool active() const {
     return _value.first;
   }
 
@@ -374,6 +1033,7 @@ public:
   iterator &operator++() {
     if (!_node)
       throw error::null_iterator("operator++()");
+    TrieT::stats_type::step();
     _node = _node->successor();
     return *this;
   }
@@ -387,6 +1047,7 @@ public:
   iterator &operator--() {
     if (!_node)
       throw error::null_iterator("operator--()");
+    TrieT::stats_type::step();
     _node = _node->predecessor();
     return *this;
   }
@@ -409,72 +1070,749 @@ private:
   pointer _node;
 };
 
-template <class KeyT, class ElemT, class PredT = std::less<KeyT>>
-class trie {
+/* a trie_iterator that only reads, for walking const tries */
+template <class TrieT>
+class const_trie_iterator : public std::iterator<std::bidirectional_iterator_tag, TrieT> {
 public:
-  typedef KeyT key_type;
-  typedef ElemT mapped_type;
-  typedef PredT pred_type;
-  typedef alphabet<key_type, pred_type> alphabet_type;
-  typedef trie<key_type, mapped_type, pred_type> self;
-  typedef trie_node<key_type, mapped_type, pred_type> value_type;
+  typedef const_trie_iterator iterator;
+  typedef typename TrieT::const_pointer pointer;
+  typedef typename TrieT::const_reference reference;
 
-  typedef size_t size_type;
-  typedef ptrdiff_t difference_type;
-  typedef value_type *pointer;
-  typedef const value_type *const_pointer;
+  explicit const_trie_iterator(pointer node) : _node(node) {}
+
+  const_trie_iterator(const trie_iterator<TrieT> &it) : _node(it.operator->()) {}
+
+  reference operator*() const {
+    if (!_node)
+      throw error::null_iterator("operator*()");
+    return *_node;
+  }
+
+  pointer operator->() const {
+    return _node;
+  }
+
+  iterator &operator++() {
+    if (!_node)
+      throw error::null_iterator("operator++()");
+    TrieT::stats_type::step();
+    _node = _node->successor();
+    return *this;
+  }
+
+  iterator operator++(int) {
+    iterator copy = *this;
+    ++(*this);
+    return copy;
+  }
+
+  iterator &operator--() {
+    if (!_node)
+      throw error::null_iterator("operator--()");
+    TrieT::stats_type::step();
+    _node = _node->predecessor();
+    return *this;
+  }
+
+  iterator operator--(int) {
+    iterator copy = *this;
+    --(*this);
+    return copy;
+  }
+
+  friend bool operator==(const iterator &left, const iterator &right) {
+    return left._node == right._node;
+  }
+
+  friend bool operator!=(const iterator &left, const iterator &right) {
+    return !(left == right);
+  }
+
+private:
+  pointer _node;
+};
+
+/*
+Matches input against the trie one symbol at a time, remembering the longest
+stored key seen so far. Input may arrive in pieces, e.g. across packets.
+*/
+template <class TrieT>
+class trie_cursor {
+public:
+  typedef typename TrieT::key_type key_type;
+  typedef typename TrieT::size_type size_type;
+  typedef typename TrieT::pointer pointer;
+  typedef typename TrieT::iterator iterator;
+
+  explicit trie_cursor(pointer root) : _root(root) {
+    reset();
+  }
+
+  /* returns false once the input can no longer lead to a stored key */
+  bool advance(const key_type &symbol) {
+    if (!_node)
+      return false;
+    ++_consumed;
+    if (!((_node = _node->find_child(symbol))))
+      return false;
+    if (_node->active()) {
+      _match = _node;
+      _match_length = _consumed;
+    }
+    return true;
+  }
+
+  template <class SequenceT>
+  bool advance(const SequenceT &input) {
+    return advance(_std::begin(input), _std::end(input));
+  }
+
+  template <class IterT, class EndT>
+  bool advance(IterT first, EndT last) {
+    for (; first != last; ++first)
+      if (!advance(*first))
+        return false;
+    return true;
+  }
+
+  void reset() {
+    _node = _root;
+    _match = _root->active() ? _root : nullptr;
+    _consumed = 0;
+    _match_length = 0;
+  }
+
+  bool alive() const {
+    return _node != nullptr;
+  }
+
+  bool matched() const {
+    return _match != nullptr;
+  }
+
+  /*
+  The longest stored key that prefixes the input so far, or a null iterator,
+  as find gives for a miss, if none. A match on the empty key is the root,
+  which is the trie's end().
+  */
+  iterator match() const {
+    return iterator(_match);
+  }
+
+  size_type match_length() const {
+    return _match_length;
+  }
+
+  size_type consumed() const {
+    return _consumed;
+  }
+
+private:
+  pointer _root, _node, _match;
+  size_type _consumed, _match_length;
+};
+
+/*
+A bounded front cache of lookups: a set associative table from keys to the
+nodes holding their values, consulted before walking the trie. Keys are
+stored as alphabet indices, so keys the alphabet orders as equal share an
+entry, and only keys of up to key_capacity symbols are cached.
+
+The trie keeps it valid: it forgets a node's entry when the node is erased
+and clears the table when subtrees are removed or moved.
+*/
+template <class TrieT>
+class trie_cache {
+public:
+  typedef typename TrieT::pointer pointer;
+  typedef typename TrieT::size_type size_type;
+  typedef typename TrieT::alphabet_type alphabet_type;
+
+  static const size_type ways = 4;
+  static const size_type key_capacity = 24;
+
+  /* at least entries entries, rounded up to a power of two sets */
+  trie_cache(const size_type entries, const alphabet_type &alphabet) : _sets(1), _alphabet(&alphabet), _hits(0), _misses(0), _length(-1) {
+    while (_sets * ways < entries)
+      _sets *= 2;
+    _hashes.resize(_sets * ways);
+    _entries.resize(_sets * ways);
+    clear();
+  }
+
+  /* the cached node for key, or null; a miss leaves key ready for add */
+  template <class IterT, class EndT>
+  pointer find(IterT first, EndT last) {
+    if (!encode(first, last))
+      return nullptr;
+    const size_type set = (_hash & (_sets - 1)) * ways;
+    for (size_type i = set; i < set + ways; ++i)
+      if (_hashes[i] == _hash && same(_entries[i])) {
+        ++_hits;
+        pointer node = _entries[i].node;
+        /* move to the front of the set, which is kept in recently used order */
+        for (; i > set; --i) {
+          std::swap(_hashes[i], _hashes[i - 1]);
+          std::swap(_entries[i], _entries[i - 1]);
+        }
+        return node;
+      }
+    ++_misses;
+    return nullptr;
+  }
+
+  /* caches node under the key of the last find that missed */
+  void add(pointer node) {
+    if (_length < 0)
+      return;
+    const size_type set = (_hash & (_sets - 1)) * ways;
+    for (size_type i = set + ways - 1; i > set; --i) {
+      _hashes[i] = _hashes[i - 1];
+      _entries[i] = _entries[i - 1];
+    }
+    _hashes[set] = _hash;
+    _entries[set].node = node;
+    _entries[set].length = _length;
+    std::copy(_key, _key + _length, _entries[set].key);
+    _length = -1;
+  }
+
+  void forget(pointer node) {
+    size_t depth = node->depth();
+    if (depth > key_capacity)
+      return;
+    _length = int(depth);
+    for (pointer next = node; next->_parent; next = next->_parent)
+      _key[--depth] = next->index_of(next->_key);
+    _hash = hash();
+    const size_type set = (_hash & (_sets - 1)) * ways;
+    for (size_type i = set; i < set + ways; ++i)
+      if (_entries[i].node == node)
+        _entries[i].node = nullptr;
+    _length = -1;
+  }
+
+  void clear() {
+    for (auto &it : _entries)
+      it.node = nullptr;
+    _length = -1;
+  }
+
+  size_type hits() const {
+    return _hits;
+  }
+
+  size_type misses() const {
+    return _misses;
+  }
+
+  size_type capacity() const {
+    return _entries.size();
+  }
+
+private:
+  struct entry {
+    pointer node;
+    int length;
+    int key[key_capacity];
+  };
+
+  size_type _sets;
+  std::vector<size_t> _hashes;
+  std::vector<entry> _entries;
+  const alphabet_type *_alphabet;
+  size_type _hits, _misses;
+
+  /* the key last encoded, or a length of -1 if it cannot be cached */
+  int _key[key_capacity];
+  int _length;
+  size_t _hash;
+
+  template <class IterT, class EndT>
+  bool encode(IterT first, EndT last) {
+    _length = 0;
+    for (; first != last; ++first) {
+      int index = _alphabet->index_of(*first);
+      if (index < 0 || _length == int(key_capacity)) {
+        _length = -1;
+        return false;
+      }
+      _key[_length++] = index;
+    }
+    _hash = hash();
+    return true;
+  }
+
+  size_t hash() const {
+    unsigned long long h = 0xcbf29ce484222325ull;
+    for (int i = 0; i < _length; ++i)
+      h = (h ^ unsigned(_key[i])) * 0x100000001b3ull;
+    return size_t(h ^ (h >> 32));
+  }
+
+  bool same(const entry &e) const {
+    return e.node && e.length == _length && std::equal(_key, _key + _length, e.key);
+  }
+};
+
+template <class KeyT, class ElemT, class PredT, class StatsT>
+class trie {
+public:
+  typedef KeyT key_type;
+  typedef ElemT mapped_type;
+  typedef PredT pred_type;
+  typedef alphabet<key_type, pred_type> alphabet_type;
+  typedef StatsT stats_type;
+  typedef trie<key_type, mapped_type, pred_type, stats_type> self;
+  typedef trie_node<key_type, mapped_type, pred_type, stats_type> value_type;
+
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef value_type *pointer;
+  typedef const value_type *const_pointer;
   typedef value_type& reference;
   typedef const value_type& const_reference;
 
   typedef trie_iterator<self> iterator;
-  typedef std::reverse_iterator<iterator> reverse_iterator;
-
-  /*
-  TODO:
   typedef const_trie_iterator<self> const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
   typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
-  */
+  typedef trie_cursor<self> cursor_type;
+  typedef trie_cache<self> cache_type;
+
+  friend aho_corasick<self>;
+  friend trie_pattern<self>;
+  friend dawg<key_type, pred_type>;
+  friend durable_trie<self>;
+  friend trie_partition<self>;
 
   template <class SequenceT>
-  explicit trie(const SequenceT &alpha) : _alphabet(alpha) {
+  explicit trie(const SequenceT &alpha) : _alphabet(alpha), _cache(nullptr) {
     _root._alphabet = &_alphabet;
   }
 
+  /* nodes and the cache are owned by the trie and not shared between copies */
+  trie(const self &) = delete;
+  self &operator=(const self &) = delete;
+
+  ~trie() {
+    clear();
+    delete _cache;
+  }
+
+  /*
+  Keys may be any sequence with begin() and end() (std::string, std::string_view, std::vector, ...),
+  a null-terminated string, or given as an iterator range or a pointer and length.
+  */
+
   template <class SequenceT>
   mapped_type &operator[](const SequenceT &key) {
-    return _root[key];
+    typename stats_type::scope timed(trie_operation::insert);
+    if (_cache)
+      if (pointer node = _cache->find(_std::begin(key), _std::end(key)))
+        return node->_value.second;
+    return _root.get(_std::begin(key), _std::end(key));
+  }
+
+  template <class SequenceT>
+  std::pair<iterator, bool> insert(const SequenceT &key, const mapped_type &value) {
+    typename stats_type::scope timed(trie_operation::insert);
+    return insert_result(_root.insert(_std::begin(key), _std::end(key), value));
+  }
+
+  template <class IterT>
+  std::pair<iterator, bool> insert(IterT first, IterT last, const mapped_type &value) {
+    typename stats_type::scope timed(trie_operation::insert);
+    return insert_result(_root.insert(first, last, value));
+  }
+
+  std::pair<iterator, bool> insert(const key_type *key, size_type length, const mapped_type &value) {
+    typename stats_type::scope timed(trie_operation::insert);
+    return insert_result(_root.insert(key, key + length, value));
   }
 
   template <class SequenceT>
   iterator find(const SequenceT &key) {
-    return iterator(_root.find(key));
+    return iterator(lookup(_std::begin(key), _std::end(key)));
+  }
+
+  template <class IterT>
+  iterator find(IterT first, IterT last) {
+    return iterator(lookup(first, last));
+  }
+
+  iterator find(const key_type *key, size_type length) {
+    return iterator(lookup(key, key + length));
   }
 
   template <class SequenceT>
   bool has(const SequenceT &key) {
-    return _root.has(key);
+    return active(lookup(_std::begin(key), _std::end(key)));
+  }
+
+  template <class IterT>
+  bool has(IterT first, IterT last) {
+    return active(lookup(first, last));
+  }
+
+  bool has(const key_type *key, size_type length) {
+    return active(lookup(key, key + length));
+  }
+
+  /*
+  Reads on a const trie never allocate, throw, or touch the front cache, so
+  with no_stats any number of threads may share one as long as none of them
+  writes to it. Other stats policies count reads in shared, unsynchronized
+  counters, so concurrent reads race on those. A symbol outside the alphabet
+  is simply a miss.
+  */
+
+  template <class SequenceT>
+  const_iterator find(const SequenceT &key) const {
+    return const_iterator(search(_std::begin(key), _std::end(key)));
+  }
+
+  template <class IterT>
+  const_iterator find(IterT first, IterT last) const {
+    return const_iterator(search(first, last));
+  }
+
+  const_iterator find(const key_type *key, size_type length) const {
+    return const_iterator(search(key, key + length));
+  }
+
+  template <class SequenceT>
+  bool has(const SequenceT &key) const {
+    return active(search(_std::begin(key), _std::end(key)));
+  }
+
+  template <class IterT>
+  bool has(IterT first, IterT last) const {
+    return active(search(first, last));
+  }
+
+  bool has(const key_type *key, size_type length) const {
+    return active(search(key, key + length));
+  }
+
+  /* the value stored for key, or null if there is none */
+  template <class SequenceT>
+  mapped_type *try_get(const SequenceT &key) {
+    return value_of(lookup(_std::begin(key), _std::end(key)));
+  }
+
+  template <class IterT>
+  mapped_type *try_get(IterT first, IterT last) {
+    return value_of(lookup(first, last));
+  }
+
+  mapped_type *try_get(const key_type *key, size_type length) {
+    return value_of(lookup(key, key + length));
+  }
+
+  template <class SequenceT>
+  const mapped_type *try_get(const SequenceT &key) const {
+    return value_of(search(_std::begin(key), _std::end(key)));
+  }
+
+  template <class IterT>
+  const mapped_type *try_get(IterT first, IterT last) const {
+    return value_of(search(first, last));
+  }
+
+  const mapped_type *try_get(const key_type *key, size_type length) const {
+    return value_of(search(key, key + length));
+  }
+
+  /* the value stored for key; unlike operator[], throws error::key_not_found rather than inserting */
+  template <class SequenceT>
+  mapped_type &at(const SequenceT &key) {
+    return value_at(lookup(_std::begin(key), _std::end(key)));
+  }
+
+  template <class IterT>
+  mapped_type &at(IterT first, IterT last) {
+    return value_at(lookup(first, last));
+  }
+
+  mapped_type &at(const key_type *key, size_type length) {
+    return value_at(lookup(key, key + length));
+  }
+
+  template <class SequenceT>
+  const mapped_type &at(const SequenceT &key) const {
+    return value_at(search(_std::begin(key), _std::end(key)));
+  }
+
+  template <class IterT>
+  const mapped_type &at(IterT first, IterT last) const {
+    return value_at(search(first, last));
+  }
+
+  const mapped_type &at(const key_type *key, size_type length) const {
+    return value_at(search(key, key + length));
+  }
+
+  /*
+  Puts a front cache of at least entries keys before the reads of a
+  non-const trie and operator[], for lookups that keep returning to the same
+  keys (see trie_cache). Keys are cached when a read reaches them.
+  */
+  void enable_cache(size_type entries) {
+    delete _cache;
+    _cache = new cache_type(entries, _alphabet);
+  }
+
+  void disable_cache() {
+    delete _cache;
+    _cache = nullptr;
+  }
+
+  const cache_type *cache() const {
+    return _cache;
+  }
+
+  /*
+  The longest stored key that prefixes input, or a null iterator, as find
+  gives for a miss, if there is none. The empty key is stored in the root, so
+  a match on it is end(), which no miss compares equal to.
+  */
+  template <class SequenceT>
+  iterator longest_prefix_match(const SequenceT &input) {
+    return longest_prefix_match(_std::begin(input), _std::end(input));
+  }
+
+  template <class IterT, class EndT>
+  iterator longest_prefix_match(IterT first, EndT last) {
+    pointer match = nullptr;
+    _root.prefixes(first, last, [&](pointer node) { match = node; });
+    return iterator(match);
+  }
+
+  /* writes an iterator to every stored key that prefixes input, shortest first */
+  template <class SequenceT, class OutputIt>
+  OutputIt prefixes_of(const SequenceT &input, OutputIt out) {
+    return prefixes_of(_std::begin(input), _std::end(input), out);
+  }
+
+  template <class IterT, class EndT, class OutputIt>
+  OutputIt prefixes_of(IterT first, EndT last, OutputIt out) {
+    _root.prefixes(first, last, [&](pointer node) { *out++ = iterator(node); });
+    return out;
+  }
+
+  cursor_type cursor() {
+    return cursor_type(&_root);
+  }
+
+  /*
+  Writes a std::pair<iterator, size_type> for every stored key within max_distance
+  insertions, deletions or substitutions of query, in key order.
+  */
+  template <class SequenceT, class OutputIt>
+  OutputIt fuzzy_find(const SequenceT &query, size_type max_distance, OutputIt out) {
+    std::vector<int> indices;
+    for (auto first = _std::begin(query), last = _std::end(query); first != last; ++first)
+      indices.push_back(_alphabet.index_of(*first));
+
+    std::vector<size_type> rows(indices.size() + 1);
+    for (size_type i = 0; i < rows.size(); ++i)
+      rows[i] = i;
+
+    auto visit = [&](pointer node, size_type distance) { *out++ = std::make_pair(iterator(node), distance); };
+    if (_root._value.first && indices.size() <= max_distance)
+      visit(&_root, indices.size());
+    _root.fuzzy(indices, rows, 0, max_distance, visit);
+    return out;
+  }
+
+  /*
+  Writes an iterator to every stored key accepted by pattern, in key order. Only
+  children the pattern can accept at each step are visited (see trie_pattern).
+  */
+  template <class PatternT, class OutputIt>
+  OutputIt match(const PatternT &pattern, OutputIt out) {
+    auto visit = [&](pointer node) { *out++ = iterator(node); };
+    _root.match(pattern, pattern.start(), visit);
+    return out;
+  }
+
+  /*
+  Set operations with another trie over the same alphabet, which throw
+  error::alphabet_mismatch otherwise. Both tries are walked together, so
+  subtrees on only one side cost nothing to skip, and merge moves them over
+  without copying. combine(mine, theirs) gives the value kept for a key in
+  both; by default this trie's value is kept.
+  */
+
+  template <class CombineT>
+  void merge(self &&other, CombineT combine) {
+    if (&other == this)
+      return;
+    check_alphabet(other, "merge");
+    other.invalidate_cache();
+    _root.merge(&other._root, combine);
+    _regions.insert(_regions.end(), other._regions.begin(), other._regions.end());
+    other._regions.clear();
+  }
+
+  void merge(self &&other) {
+    merge(std::move(other), keep_mine());
+  }
+
+  template <class CombineT>
+  void intersect(const self &other, CombineT combine) {
+    if (&other == this)
+      return;
+    check_alphabet(other, "intersect");
+    invalidate_cache();
+    _root.intersect(&other._root, combine);
+  }
+
+  void intersect(const self &other) {
+    intersect(other, keep_mine());
+  }
+
+  void difference(const self &other) {
+    if (&other == this) {
+      clear();
+      return;
+    }
+    check_alphabet(other, "difference");
+    invalidate_cache();
+    _root.difference(&other._root);
   }
 
   template <class SequenceT>
   size_type erase(const SequenceT &key) {
-    return _root.remove(key) ? 1 : 0;
+    typename stats_type::scope timed(trie_operation::erase);
+    if (_cache)
+      if (pointer node = _root.find(_std::begin(key), _std::end(key)))
+        _cache->forget(node);
+    return _root.remove(_std::begin(key), _std::end(key)) ? 1 : 0;
   }
 
   iterator erase(iterator pos) {
+    typename stats_type::scope timed(trie_operation::erase);
     auto curr = pos++;
+    if (_cache)
+      _cache->forget(curr.operator->());
     curr->erase();
     return pos;
   }
 
+  /*
+  Subtrees wholly inside the range are unlinked and deleted in one go rather
+  than key by key.
+  */
   iterator erase(iterator first, iterator last) {
+    typename stats_type::scope timed(trie_operation::erase);
+    std::vector<pointer> bound;
+    for (pointer node = last.operator->(); node; node = node->_parent)
+      bound.push_back(node);
+    auto holds_last = [&](pointer node) { return std::find(bound.begin(), bound.end(), node) != bound.end(); };
+    invalidate_cache();
+
     auto it = first;
-    while (it != last)
-      it = erase(it);
+    while (it != last) {
+      pointer node = it.operator->();
+      if (holds_last(node)) {
+        ++it;
+        node->erase();
+        continue;
+      }
+      /* climb while the parent's subtree also starts at it and ends before last */
+      for (pointer parent; (parent = node->_parent)->_parent && !parent->_value.first
+          && parent->next_child(0) == parent->index_of(node->_key) && !holds_last(parent);)
+        node = parent;
+      it = iterator(node->last()->successor());
+      node->clear();
+      node->prune_upwards();
+    }
     return it;
   }
 
+  /* erases every key starting with prefix, unlinking its subtree whole, and returns how many there were */
+  template <class SequenceT>
+  size_type erase_prefix(const SequenceT &prefix) {
+    typename stats_type::scope timed(trie_operation::erase);
+    invalidate_cache();
+    return _root.remove_prefix(_std::begin(prefix), _std::end(prefix));
+  }
+
+  template <class IterT>
+  size_type erase_prefix(IterT first, IterT last) {
+    typename stats_type::scope timed(trie_operation::erase);
+    invalidate_cache();
+    return _root.remove_prefix(first, last);
+  }
+
+  size_type erase_prefix(const key_type *prefix, size_type length) {
+    typename stats_type::scope timed(trie_operation::erase);
+    invalidate_cache();
+    return _root.remove_prefix(prefix, prefix + length);
+  }
+
   void clear() {
-    _root = value_type();
+    invalidate_cache();
+    _root.clear();
+    release_regions();
+  }
+
+  /*
+  Moves every node and child table into one new region, laid out so that a
+  lookup touches few cache lines and pages: the top levels breadth first, as
+  every lookup passes through them, then the subtrees below them in page
+  sized blocks (see blocks), with every node's child table right after it. Worth running after many
+  inserts and erases have scattered nodes across the heap. Iterators are
+  invalidated.
+  */
+  void compact() {
+    invalidate_cache();
+    const size_type width = _alphabet.size();
+    std::vector<pointer> order;
+    blocks(&_root, compact_top_nodes, order);
+
+    std::vector<size_type> offsets;
+    size_type total = aligned(_root._nodes.bytes(width));
+    for (auto node : order) {
+      offsets.push_back(total);
+      total += aligned(sizeof(value_type)) + aligned(node->_nodes.bytes(width));
+    }
+    char *region = new char[total];
+
+    /* the old nodes' parent pointers forward to their copies until every table is placed */
+    for (size_type i = 0; i < order.size(); ++i) {
+      pointer node = order[i];
+      pointer moved = new (region + offsets[i]) value_type(node->_key, node->_parent, node->_alphabet);
+      stats_type::node_allocated();
+      moved->_value = std::move(node->_value);
+      moved->_pooled = true;
+      node->_parent = moved;
+    }
+
+    auto forward = [](pointer node) { return node->_parent; };
+    for (size_type i = 0; i < order.size(); ++i) {
+      pointer node = order[i], moved = node->_parent;
+      if (moved->_parent != &_root)
+        moved->_parent = moved->_parent->_parent;
+      moved->_nodes = node->_nodes;
+      moved->_nodes.place(region + offsets[i] + aligned(sizeof(value_type)), width, forward);
+      moved->_pooled_children = true;
+    }
+    trie_children<value_type> table = _root._nodes;
+    table.place(region, width, forward);
+
+    for (auto node : order) {
+      node->release_children();
+      value_type::destroy(node);
+    }
+    _root.release_children();
+    _root._nodes = table;
+    _root._pooled_children = true;
+
+    release_regions();
+    _regions.push_back(region);
   }
 
   size_t size() const {
@@ -500,8 +1838,142 @@ public:
     return reverse_iterator(begin());
   }
 
+  const_iterator begin() const {
+    const_pointer node = _root.successor();
+    return const_iterator(node ? node : &_root);
+  }
+
+  const_iterator end() const {
+    return const_iterator(&_root);
+  }
+
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  const_iterator cbegin() const {
+    return begin();
+  }
+
+  const_iterator cend() const {
+    return end();
+  }
+
 protected:
   value_type _root;
   alphabet_type _alphabet;
+  /* storage of nodes and tables laid out by compact, freed once none of them are used */
+  std::vector<char *> _regions;
+  cache_type *_cache;
+
+private:
+  static const size_type compact_top_nodes = 4096;
+  static const size_type compact_block_nodes = 32;
+
+  template <class IterT, class EndT>
+  pointer lookup(IterT first, EndT last) {
+    typename stats_type::scope timed(trie_operation::find);
+    pointer node = _cache ? _cache->find(first, last) : nullptr;
+    if (!node) {
+      node = _root.find(first, last);
+      if (_cache && active(node))
+        _cache->add(node);
+    }
+    stats_type::found(active(node));
+    return node;
+  }
+
+  template <class IterT, class EndT>
+  const_pointer search(IterT first, EndT last) const {
+    typename stats_type::scope timed(trie_operation::find);
+    const_pointer node = _root.find(first, last);
+    stats_type::found(active(node));
+    return node;
+  }
+
+  static bool active(const_pointer node) {
+    return node && node->_value.first;
+  }
+
+  static mapped_type *value_of(pointer node) {
+    return active(node) ? &node->_value.second : nullptr;
+  }
+
+  static const mapped_type *value_of(const_pointer node) {
+    return active(node) ? &node->_value.second : nullptr;
+  }
+
+  static mapped_type &value_at(pointer node) {
+    if (!active(node))
+      throw error::key_not_found();
+    return node->_value.second;
+  }
+
+  static const mapped_type &value_at(const_pointer node) {
+    if (!active(node))
+      throw error::key_not_found();
+    return node->_value.second;
+  }
+
+  void invalidate_cache() {
+    if (_cache)
+      _cache->clear();
+  }
+
+  static std::pair<iterator, bool> insert_result(const std::pair<pointer, bool> &result) {
+    return std::make_pair(iterator(result.first), result.second);
+  }
+
+  struct keep_mine {
+    const mapped_type &operator()(const mapped_type &mine, const mapped_type &) const {
+      return mine;
+    }
+  };
+
+  static size_type aligned(const size_type bytes) {
+    const size_type alignment = alignof(value_type) > alignof(unsigned long long) ? alignof(value_type) : alignof(unsigned long long);
+    return (bytes + alignment - 1) / alignment * alignment;
+  }
+
+  /*
+  Appends the nodes below node in blocks: whole levels breadth first while
+  they fit in budget nodes, then each node hanging below the block followed
+  by its own subtree, in blocks of about a page.
+  */
+  static void blocks(pointer node, const size_type budget, std::vector<pointer> &order) {
+    std::vector<pointer> level(1, node), next;
+    for (size_type taken = 0;;) {
+      next.clear();
+      for (auto it : level)
+        for (int i = it->next_child(0); i >= 0; i = it->next_child(i + 1))
+          next.push_back(it->child(i));
+      if (next.empty())
+        return;
+      if (taken && taken + next.size() > budget)
+        break;
+      order.insert(order.end(), next.begin(), next.end());
+      taken += next.size();
+      level.swap(next);
+    }
+    for (auto it : next) {
+      order.push_back(it);
+      blocks(it, compact_block_nodes, order);
+    }
+  }
+
+  void release_regions() {
+    for (auto region : _regions)
+      delete[] region;
+    _regions.clear();
+  }
+
+  void check_alphabet(const self &other, const std::string &operation) const {
+    if (_alphabet != other._alphabet)
+      throw error::alphabet_mismatch(operation);
+  }
 };
 
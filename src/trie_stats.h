@@ -0,0 +1,188 @@
+#pragma once
+
+#include "trie.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* operation latencies in power of two buckets of nanoseconds */
+struct latency_histogram {
+  static const size_t bucket_count = 48;
+
+  unsigned long long buckets[bucket_count];
+  unsigned long long count, total;
+
+  void add(const unsigned long long nanoseconds) {
+    size_t bucket = nanoseconds ? 64 - _std::countl_zero(nanoseconds) : 0;
+    ++buckets[bucket < bucket_count ? bucket : bucket_count - 1];
+    ++count;
+    total += nanoseconds;
+  }
+
+  /* an upper bound, within a factor of two, on the latency of the given fraction of operations */
+  unsigned long long percentile(const double fraction) const {
+    unsigned long long seen = 0;
+    for (size_t i = 0; i < bucket_count; ++i)
+      if ((seen += buckets[i]) >= fraction * count)
+        return i ? 1ull << i : 0;
+    return 1ull << (bucket_count - 1);
+  }
+
+  unsigned long long mean() const {
+    return count ? total / count : 0;
+  }
+};
+
+struct trie_counters {
+  /* calls of each trie_operation, and their latencies and cache misses */
+  unsigned long long operations[3];
+  latency_histogram latency[3];
+  unsigned long long cache_misses[3];
+
+  unsigned long long find_hits, find_misses;
+  unsigned long long iterator_steps;
+  unsigned long long nodes_allocated, nodes_freed;
+  unsigned long long index_lookups;
+  unsigned long long traversals, traversed_nodes;
+
+  unsigned long long of(const trie_operation operation) const {
+    return operations[int(operation)];
+  }
+
+  const latency_histogram &latency_of(const trie_operation operation) const {
+    return latency[int(operation)];
+  }
+};
+
+/*
+Instrumentation policy for trie<KeyT, ElemT, PredT, trie_stats<Tag>>, counting
+operations, node allocations, traversal depth and index lookups, and timing
+each operation into a histogram.
+
+The counters are shared by every trie with the same policy and are not
+synchronized, even for reads of a const trie, so only one thread may use
+such tries at a time; give tries their own Tag to count them apart.
+*/
+template <class Tag = void>
+class trie_stats {
+public:
+  class scope {
+  public:
+    explicit scope(const trie_operation operation) : _operation(operation), _start(clock::now()) {}
+
+    ~scope() {
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - _start).count();
+      trie_counters &x = counters();
+      ++x.operations[int(_operation)];
+      x.latency[int(_operation)].add(static_cast<unsigned long long>(elapsed));
+    }
+
+  private:
+    typedef std::chrono::steady_clock clock;
+
+    trie_operation _operation;
+    clock::time_point _start;
+  };
+
+  static trie_counters &counters() {
+    static trie_counters x = trie_counters();
+    return x;
+  }
+
+  static void reset() {
+    counters() = trie_counters();
+  }
+
+  static void found(const bool hit) {
+    ++(hit ? counters().find_hits : counters().find_misses);
+  }
+
+  static void step() {
+    ++counters().iterator_steps;
+  }
+
+  static void node_allocated() {
+    ++counters().nodes_allocated;
+  }
+
+  static void node_freed() {
+    ++counters().nodes_freed;
+  }
+
+  static void index_lookup() {
+    ++counters().index_lookups;
+  }
+
+  static void traversed(const size_t depth) {
+    ++counters().traversals;
+    counters().traversed_nodes += depth;
+  }
+};
+
+/*
+trie_stats that also counts the hardware cache misses of the calling thread
+during each operation, read through perf_event_open. Off Linux, or where the
+kernel refuses the event (see available), the counts stay zero.
+*/
+template <class Tag = void>
+class trie_perf_stats : public trie_stats<Tag> {
+public:
+  class scope : public trie_stats<Tag>::scope {
+  public:
+    explicit scope(const trie_operation operation) : trie_stats<Tag>::scope(operation), _operation(operation), _start(cache_misses()) {}
+
+    ~scope() {
+      trie_stats<Tag>::counters().cache_misses[int(_operation)] += cache_misses() - _start;
+    }
+
+  private:
+    trie_operation _operation;
+    unsigned long long _start;
+  };
+
+  static bool available() {
+    return event().fd >= 0;
+  }
+
+private:
+  struct perf_event {
+    int fd;
+
+#if defined(__linux__)
+    perf_event() {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof attr;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fd = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ~perf_event() {
+      if (fd >= 0)
+        close(fd);
+    }
+#else
+    perf_event() : fd(-1) {}
+#endif
+  };
+
+  static perf_event &event() {
+    static thread_local perf_event e;
+    return e;
+  }
+
+  static unsigned long long cache_misses() {
+    unsigned long long value = 0;
+#if defined(__linux__)
+    if (event().fd < 0 || read(event().fd, &value, sizeof value) != sizeof value)
+      return 0;
+#endif
+    return value;
+  }
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "trie.h"
+
+namespace utf8 {
+
+  /* orders bytes as unsigned, which orders valid UTF-8 by code point */
+  struct byte_less {
+    bool operator()(const char left, const char right) const {
+      return static_cast<unsigned char>(left) < static_cast<unsigned char>(right);
+    }
+  };
+
+  inline std::string bytes() {
+    std::string result;
+    for (int i = 0; i < 256; ++i)
+      result += char(i);
+    return result;
+  }
+
+  /*
+  decodes UTF-8, replacing malformed sequences with U+FFFD: stray continuation
+  bytes, truncated sequences, overlong forms, surrogates and values past
+  U+10FFFF. A byte that breaks a sequence starts the next one.
+  */
+  template <class IterT, class EndT>
+  std::u32string decode(IterT first, EndT last) {
+    std::u32string result;
+    while (first != last) {
+      unsigned char lead = static_cast<unsigned char>(*first++);
+      int length = lead < 0x80 ? 0 : lead < 0xc2 ? -1 : lead < 0xe0 ? 1 : lead < 0xf0 ? 2 : lead < 0xf5 ? 3 : -1;
+      char32_t point = length > 0 ? lead & (0x3f >> length) : lead;
+      /* the second byte's range excludes overlong forms after E0 and F0, surrogates after ED and values past U+10FFFF after F4 */
+      unsigned char low = lead == 0xe0 ? 0xa0 : lead == 0xf0 ? 0x90 : 0x80;
+      unsigned char high = lead == 0xed ? 0x9f : lead == 0xf4 ? 0x8f : 0xbf;
+      for (int i = 0; i < length; ++i, low = 0x80, high = 0xbf) {
+        const unsigned char next = first != last ? static_cast<unsigned char>(*first) : 0;
+        if (next < low || next > high) {
+          length = -1;
+          break;
+        }
+        point = (point << 6) | (next & 0x3f);
+        ++first;
+      }
+      result += length < 0 ? char32_t(0xfffd) : point;
+    }
+    return result;
+  }
+
+  template <class SequenceT>
+  std::u32string decode(const SequenceT &bytes) {
+    return decode(_std::begin(bytes), _std::end(bytes));
+  }
+
+  inline std::string encode(const std::u32string &points) {
+    std::string result;
+    for (auto point : points) {
+      if (point < 0x80) {
+        result += char(point);
+      } else if (point < 0x800) {
+        result += char(0xc0 | (point >> 6));
+        result += char(0x80 | (point & 0x3f));
+      } else if (point < 0x10000) {
+        result += char(0xe0 | (point >> 12));
+        result += char(0x80 | ((point >> 6) & 0x3f));
+        result += char(0x80 | (point & 0x3f));
+      } else {
+        result += char(0xf0 | (point >> 18));
+        result += char(0x80 | ((point >> 12) & 0x3f));
+        result += char(0x80 | ((point >> 6) & 0x3f));
+        result += char(0x80 | (point & 0x3f));
+      }
+    }
+    return result;
+  }
+
+}
+
+/*
+Unicode keys stored as their UTF-8 bytes, so fan-out stays bounded by the
+byte alphabet however many scripts are stored. Keys are given as UTF-8 in
+any byte sequence (std::string, std::string_view, std::u8string_view, ...)
+and iterate in code point order.
+*/
+template <class ElemT>
+class utf8_trie : public trie<char, ElemT, utf8::byte_less> {
+public:
+  typedef trie<char, ElemT, utf8::byte_less> base_type;
+  typedef typename base_type::const_reference const_reference;
+
+  utf8_trie() : base_type(utf8::bytes()) {}
+
+  /* an alphabet of only the bytes keys will use, e.g. a sample of them */
+  template <class SequenceT>
+  explicit utf8_trie(const SequenceT &bytes) : base_type(bytes) {}
+
+  static std::u32string code_points(const_reference node) {
+    return utf8::decode(node.template key<std::string>());
+  }
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include "../src/aho_corasick.h"
+#include <algorithm>
+
+static const std::string _alpha =
+  "abcdefghijklmnopqrstuvwxyz"
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  "1234567890";
+
+typedef trie<char, int> trie_type;
+typedef aho_corasick<trie_type> automaton_type;
+
+class AhoCorasickTest : public ::testing::TestWithParam<automaton_type::transition_table> {
+public:
+  trie_type _trie;
+
+  AhoCorasickTest() : _trie(_alpha) {}
+
+  std::vector<std::pair<size_t, std::string>> scan(const std::string &text) {
+    automaton_type automaton(_trie, GetParam());
+    std::vector<std::pair<size_t, std::string>> matches;
+    automaton.scan(text, [&](size_t position, trie_type::iterator pattern) {
+      matches.push_back(std::make_pair(position, pattern->key<std::string>()));
+    });
+    std::sort(matches.begin(), matches.end());
+    return matches;
+  }
+};
+
+TEST_P(AhoCorasickTest, Single_Pattern) {
+  _trie["panda"] = 1;
+
+  std::vector<std::pair<size_t, std::string>> expected;
+  expected.push_back(std::make_pair(4, "panda"));
+  expected.push_back(std::make_pair(15, "panda"));
+
+  EXPECT_EQ(expected, scan("red panda, big panda"));
+}
+
+TEST_P(AhoCorasickTest, Overlapping_Patterns) {
+  _trie["he"] = 1;
+  _trie["she"] = 2;
+  _trie["his"] = 3;
+  _trie["hers"] = 4;
+
+  std::vector<std::pair<size_t, std::string>> expected;
+  expected.push_back(std::make_pair(1, "she"));
+  expected.push_back(std::make_pair(2, "he"));
+  expected.push_back(std::make_pair(2, "hers"));
+
+  EXPECT_EQ(expected, scan("ushers"));
+}
+
+TEST_P(AhoCorasickTest, Nested_Patterns) {
+  _trie["a"] = 1;
+  _trie["aa"] = 2;
+  _trie["aaa"] = 3;
+
+  EXPECT_EQ(6, scan("aaa").size());
+}
+
+TEST_P(AhoCorasickTest, Symbols_Outside_Alphabet) {
+  _trie["koala"] = 3;
+
+  std::vector<std::pair<size_t, std::string>> expected;
+  expected.push_back(std::make_pair(6, "koala"));
+
+  EXPECT_EQ(expected, scan("koa-- koala!"));
+}
+
+TEST_P(AhoCorasickTest, Matches_Agree_With_Find) {
+  std::string text = "polarpolandpolarizepandapolarity";
+  _trie["polar"] = 1;
+  _trie["poland"] = 2;
+  _trie["polarize"] = 3;
+  _trie["polarity"] = 4;
+  _trie["and"] = 5;
+  _trie["a"] = 6;
+
+  std::vector<std::pair<size_t, std::string>> expected;
+  for (size_t i = 0; i < text.size(); ++i)
+    for (size_t k = i + 1; k <= text.size(); ++k)
+      if (_trie.has(text.substr(i, k - i)))
+        expected.push_back(std::make_pair(i, text.substr(i, k - i)));
+
+  EXPECT_EQ(expected, scan(text));
+}
+
+INSTANTIATE_TEST_CASE_P(Transitions, AhoCorasickTest,
+  ::testing::Values(automaton_type::sparse, automaton_type::dense));
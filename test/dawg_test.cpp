@@ -0,0 +1,142 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include "../src/dawg.h"
+#include <algorithm>
+#include <random>
+
+static const std::string _alpha =
+  "abcdefghijklmnopqrstuvwxyz"
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  "1234567890";
+
+class DawgTest : public ::testing::Test {
+public:
+  dawg<char> _dawg;
+
+  DawgTest() : _dawg(_alpha) {}
+};
+
+TEST_F(DawgTest, Has) {
+  for (auto &it : { "panda", "pandas", "polar", "polars" })
+    _dawg.insert(it);
+  _dawg.finish();
+
+  EXPECT_TRUE(_dawg.has("panda"));
+  EXPECT_TRUE(_dawg.has("polars"));
+  EXPECT_FALSE(_dawg.has("pand"));
+  EXPECT_FALSE(_dawg.has("koala"));
+  EXPECT_FALSE(_dawg.has("pand!"));
+  EXPECT_FALSE(_dawg.has(""));
+  EXPECT_EQ(4, _dawg.size());
+}
+
+TEST_F(DawgTest, Shares_Suffixes) {
+  for (auto &it : { "jumping", "jumps", "running", "runs", "walking", "walks" })
+    _dawg.insert(it);
+  _dawg.finish();
+
+  /* "jump" and "walk" end in the same state, and every key shares the "ng" and "s" tails */
+  EXPECT_EQ(6, _dawg.size());
+  EXPECT_EQ(15, _dawg.states());
+}
+
+TEST_F(DawgTest, Enumerate_In_Order) {
+  std::vector<std::string> words = { "", "a", "ab", "abc", "b", "ba", "bab", "c" };
+  for (auto &it : words)
+    _dawg.insert(it);
+  _dawg.finish();
+
+  std::vector<std::string> keys;
+  _dawg.keys<std::string>(std::back_inserter(keys));
+  EXPECT_EQ(words, keys);
+}
+
+TEST_F(DawgTest, Perfect_Hash) {
+  std::vector<std::string> words = { "", "a", "ab", "abc", "b", "ba", "bab", "c" };
+  for (auto &it : words)
+    _dawg.insert(it);
+  _dawg.finish();
+
+  /* a finished dawg is read only */
+  const dawg<char> &reader = _dawg;
+  for (size_t i = 0; i < words.size(); ++i) {
+    EXPECT_EQ(i, reader.index_of(words[i]));
+    EXPECT_EQ(words[i], reader.key_at<std::string>(i));
+  }
+  EXPECT_EQ(-1, reader.index_of("bb"));
+  EXPECT_EQ(-1, reader.index_of("abcd"));
+  EXPECT_THROW(reader.key_at<std::string>(words.size()), error::key_index_out_of_range);
+}
+
+TEST_F(DawgTest, Insert_Order) {
+  _dawg.insert("panda");
+  _dawg.insert("panda");
+  EXPECT_THROW(_dawg.insert("pan"), error::invalid_dawg_insert);
+  EXPECT_THROW(_dawg.insert("koala"), error::invalid_dawg_insert);
+  EXPECT_THROW(_dawg.insert("pand!"), error::not_in_alphabet);
+  _dawg.insert("polar");
+  _dawg.finish();
+
+  EXPECT_EQ(2, _dawg.size());
+  EXPECT_THROW(_dawg.insert("zebra"), error::invalid_dawg_insert);
+}
+
+TEST_F(DawgTest, Query_Before_Finish) {
+  for (auto &it : { "a", "ab", "b" })
+    _dawg.insert(it);
+
+  EXPECT_THROW(_dawg.has("ab"), error::dawg_not_finished);
+  EXPECT_THROW(_dawg.index_of("b"), error::dawg_not_finished);
+  EXPECT_THROW(_dawg.key_at<std::string>(0), error::dawg_not_finished);
+  EXPECT_THROW(_dawg.size(), error::dawg_not_finished);
+  std::vector<std::string> keys;
+  EXPECT_THROW(_dawg.keys<std::string>(std::back_inserter(keys)), error::dawg_not_finished);
+
+  _dawg.finish();
+  EXPECT_TRUE(_dawg.has("ab"));
+  EXPECT_TRUE(_dawg.has("b"));
+}
+
+TEST_F(DawgTest, Empty) {
+  _dawg.finish();
+  EXPECT_TRUE(_dawg.empty());
+  EXPECT_FALSE(_dawg.has(""));
+  EXPECT_EQ(-1, _dawg.index_of(""));
+}
+
+TEST_F(DawgTest, Minimize_Trie) {
+  trie<char, int> words(_alpha);
+  std::mt19937 gen(11);
+  for (int i = 0; i < 5000; ++i) {
+    std::string key(gen() % 8, ' ');
+    for (auto &ch : key)
+      ch = _alpha[gen() % 6];
+    words[key] = 1;
+  }
+
+  auto minimal = dawg<char>::minimize(words);
+  EXPECT_EQ(words.size(), minimal.size());
+  EXPECT_TRUE(minimal.has(""));
+
+  std::vector<std::string> keys;
+  minimal.keys<std::string>(std::back_inserter(keys));
+  ASSERT_EQ(words.size(), keys.size());
+  EXPECT_EQ("", keys[0]);
+
+  size_t i = 1;
+  for (auto &node : words) {
+    EXPECT_EQ(node.key<std::string>(), keys[i]);
+    EXPECT_EQ(i, minimal.index_of(keys[i]));
+    ++i;
+  }
+
+  /* no two states are equivalent, so building again from the keys gives the same size */
+  dawg<char> rebuilt(_alpha);
+  for (auto &it : keys)
+    rebuilt.insert(it);
+  rebuilt.finish();
+  EXPECT_EQ(minimal.size(), rebuilt.size());
+  EXPECT_EQ(minimal.states(), rebuilt.states());
+  EXPECT_LT(minimal.states(), keys.size());
+}
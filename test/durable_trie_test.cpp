@@ -0,0 +1,151 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <exception>
+#include <map>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include "../src/durable_trie.h"
+
+static const std::string _alpha =
+  "abcdefghijklmnopqrstuvwxyz"
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  "1234567890";
+
+class DurableTrieTest : public ::testing::Test {
+public:
+  typedef durable_trie<trie<char, int>> durable;
+
+  const std::string _path = "durable_trie_test";
+
+  DurableTrieTest() {
+    durable::destroy(_path);
+  }
+
+  ~DurableTrieTest() {
+    durable::destroy(_path);
+  }
+
+  static std::map<std::string, int> contents(const durable &stored) {
+    std::map<std::string, int> result;
+    for (auto &node : stored.data())
+      result[node.key<std::string>()] = node.value();
+    if (const int *value = stored.data().try_get(""))
+      result[""] = *value;
+    return result;
+  }
+};
+
+TEST_F(DurableTrieTest, Recover_From_Log) {
+  {
+    durable stored(_path, _alpha);
+    stored.assign("panda", 1);
+    stored.assign("polar", 2);
+    stored.assign("panda", 3);
+    stored.assign("", 4);
+    EXPECT_EQ(1, stored.erase("polar"));
+    EXPECT_EQ(0, stored.erase("koala"));
+  }
+
+  durable stored(_path, _alpha);
+  EXPECT_EQ(5, stored.replayed());
+  EXPECT_EQ(3, stored.data().at("panda"));
+  EXPECT_EQ(4, stored.data().at(""));
+  EXPECT_FALSE(stored.data().has("polar"));
+}
+
+TEST_F(DurableTrieTest, Recover_From_Snapshot_And_Log) {
+  {
+    durable stored(_path, _alpha);
+    stored.assign("panda", 1);
+    stored.assign("pandas", 2);
+    stored.assign("polar", 3);
+    stored.snapshot();
+    stored.assign("koala", 4);
+    stored.erase("pandas");
+    stored.wait();
+  }
+
+  durable stored(_path, _alpha);
+  EXPECT_EQ(2, stored.replayed());
+  EXPECT_EQ((std::map<std::string, int>{ { "koala", 4 }, { "panda", 1 }, { "polar", 3 } }), contents(stored));
+
+  /* a second snapshot replaces the first and the logs it covers */
+  stored.snapshot();
+  stored.wait();
+  std::FILE *covered = std::fopen((_path + ".log.1").c_str(), "rb");
+  EXPECT_EQ(nullptr, covered);
+  if (covered)
+    std::fclose(covered);
+}
+
+TEST_F(DurableTrieTest, Torn_Log_Tail) {
+  {
+    durable stored(_path, _alpha);
+    stored.assign("panda", 1);
+    stored.assign("polar", 2);
+  }
+
+  /* half a record, as a crash during a write would leave */
+  std::FILE *log = std::fopen((_path + ".log.0").c_str(), "ab");
+  ASSERT_NE(nullptr, log);
+  const char torn[] = { 1, 5, 'k', 'o' };
+  std::fwrite(torn, 1, sizeof torn, log);
+  std::fclose(log);
+
+  {
+    durable stored(_path, _alpha);
+    EXPECT_EQ(2, stored.replayed());
+    stored.assign("koala", 3);
+  }
+
+  durable stored(_path, _alpha);
+  EXPECT_EQ(3, stored.replayed());
+  EXPECT_EQ((std::map<std::string, int>{ { "koala", 3 }, { "panda", 1 }, { "polar", 2 } }), contents(stored));
+}
+
+TEST_F(DurableTrieTest, Corrupt_Snapshot) {
+  {
+    durable stored(_path, _alpha);
+    stored.assign("panda", 1);
+    stored.snapshot();
+  }
+
+  std::FILE *image = std::fopen((_path + ".snapshot").c_str(), "r+b");
+  ASSERT_NE(nullptr, image);
+  std::fseek(image, 20, SEEK_SET);
+  std::fputc('!', image);
+  std::fclose(image);
+
+  EXPECT_THROW(durable stored(_path, _alpha), error::persistence_failure);
+}
+
+TEST_F(DurableTrieTest, Agrees_With_Map) {
+  durability_options options;
+  options.group_size = 16;
+  options.snapshot_every = 700;
+  options.sync = false;
+
+  std::map<std::string, int> expected;
+  std::mt19937 gen(5);
+  for (int round = 0; round < 3; ++round) {
+    durable stored(_path, _alpha, options);
+    ASSERT_EQ(expected, contents(stored));
+    for (int i = 0; i < 2000; ++i) {
+      std::string key(gen() % 6, ' ');
+      for (auto &ch : key)
+        ch = _alpha[gen() % 4];
+      if (gen() % 3) {
+        stored.assign(key, i);
+        expected[key] = i;
+      } else {
+        EXPECT_EQ(expected.erase(key), stored.erase(key)) << key;
+      }
+    }
+  }
+
+  durable stored(_path, _alpha, options);
+  EXPECT_EQ(expected, contents(stored));
+}
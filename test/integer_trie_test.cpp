@@ -0,0 +1,156 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include "../src/integer_trie.h"
+#include <algorithm>
+#include <map>
+#include <random>
+
+class IntegerTrieTest : public ::testing::Test {
+public:
+  integer_trie<unsigned long long, int> _trie;
+};
+
+TEST_F(IntegerTrieTest, Insert_Retrieval) {
+  _trie[0] = 1;
+  _trie[42] = 2;
+  _trie[~0ull] = 3;
+
+  EXPECT_EQ(1, _trie[0]);
+  EXPECT_EQ(2, _trie[42]);
+  EXPECT_EQ(3, _trie[~0ull]);
+  EXPECT_TRUE(_trie.has(42));
+  EXPECT_FALSE(_trie.has(43));
+  EXPECT_EQ(3, _trie.size());
+  EXPECT_EQ(_trie.end(), _trie.find(43));
+  EXPECT_EQ(2, _trie.find(42)->value());
+}
+
+TEST_F(IntegerTrieTest, Erase) {
+  _trie[7] = 1;
+  _trie[0x700] = 2;
+
+  EXPECT_EQ(1, _trie.erase(7));
+  EXPECT_EQ(0, _trie.erase(7));
+  EXPECT_FALSE(_trie.has(7));
+  EXPECT_TRUE(_trie.has(0x700));
+  EXPECT_EQ(1, _trie.size());
+  EXPECT_EQ(_trie.end(), _trie.erase(_trie.begin()));
+  EXPECT_TRUE(_trie.empty());
+}
+
+TEST_F(IntegerTrieTest, Agrees_With_Map) {
+  std::map<unsigned long long, int> expected;
+  std::mt19937_64 gen(42);
+
+  for (int i = 0; i < 5000; ++i) {
+    unsigned long long key = i % 2 ? gen() : gen() % 1000;
+    expected[key] = i;
+    _trie[key] = i;
+  }
+  for (int i = 0; i < 1000; ++i) {
+    unsigned long long key = gen() % 1000;
+    EXPECT_EQ(expected.erase(key), _trie.erase(key));
+  }
+
+  EXPECT_EQ(expected.size(), _trie.size());
+
+  auto it = expected.begin();
+  for (auto &node : _trie) {
+    ASSERT_TRUE(it != expected.end());
+    EXPECT_EQ(it->first, node.key());
+    EXPECT_EQ(it->second, node.value());
+    ++it;
+  }
+  EXPECT_TRUE(it == expected.end());
+
+  auto rit = expected.rbegin();
+  for (auto node = _trie.rbegin(); node != _trie.rend(); ++node, ++rit)
+    EXPECT_EQ(rit->first, node->key());
+  EXPECT_TRUE(rit == expected.rend());
+
+  for (int i = 0; i < 1000; ++i) {
+    unsigned long long key = i % 2 ? gen() : gen() % 1200;
+    auto lower = expected.lower_bound(key);
+    auto upper = expected.upper_bound(key);
+    if (lower == expected.end())
+      EXPECT_EQ(_trie.end(), _trie.lower_bound(key));
+    else
+      EXPECT_EQ(lower->first, _trie.lower_bound(key)->key());
+    if (upper == expected.end())
+      EXPECT_EQ(_trie.end(), _trie.upper_bound(key));
+    else
+      EXPECT_EQ(upper->first, _trie.upper_bound(key)->key());
+  }
+}
+
+TEST_F(IntegerTrieTest, Nibble_Spans) {
+  integer_trie<unsigned, int, 4> nibbles;
+  nibbles[0xdeadbeef] = 1;
+  nibbles[0xdead0000] = 2;
+  nibbles[0x1] = 3;
+
+  std::vector<unsigned> keys;
+  for (auto &it : nibbles)
+    keys.push_back(it.key());
+  EXPECT_EQ(std::vector<unsigned>({ 0x1, 0xdead0000, 0xdeadbeef }), keys);
+  EXPECT_EQ(0xdeadbeef, nibbles.lower_bound(0xdead0001)->key());
+}
+
+TEST_F(IntegerTrieTest, Longest_Prefix_Match) {
+  integer_trie<unsigned, int> routes;
+  auto ip = [](unsigned a, unsigned b, unsigned c, unsigned d) { return (a << 24) | (b << 16) | (c << 8) | d; };
+
+  routes.route(0, 0) = 1;
+  routes.route(ip(10, 0, 0, 0), 8) = 2;
+  routes.route(ip(10, 1, 0, 0), 16) = 3;
+  routes.route(ip(10, 1, 128, 0), 17) = 4;
+  routes.route(ip(10, 1, 128, 7), 32) = 5;
+  routes.route(ip(192, 168, 0, 0), 13) = 6;
+
+  EXPECT_EQ(2, *routes.longest_prefix_match(ip(10, 2, 3, 4)).first);
+  EXPECT_EQ(3, *routes.longest_prefix_match(ip(10, 1, 3, 4)).first);
+  EXPECT_EQ(4, *routes.longest_prefix_match(ip(10, 1, 200, 4)).first);
+  EXPECT_EQ(17, routes.longest_prefix_match(ip(10, 1, 200, 4)).second);
+  EXPECT_EQ(5, *routes.longest_prefix_match(ip(10, 1, 128, 7)).first);
+  EXPECT_EQ(6, *routes.longest_prefix_match(ip(192, 175, 1, 1)).first);
+  EXPECT_EQ(1, *routes.longest_prefix_match(ip(192, 176, 1, 1)).first);
+  EXPECT_EQ(0, routes.size());
+
+  EXPECT_EQ(1, routes.erase_route(ip(10, 1, 128, 0), 17));
+  EXPECT_EQ(3, *routes.longest_prefix_match(ip(10, 1, 200, 4)).first);
+  EXPECT_EQ(1, routes.erase_route(0, 0));
+  EXPECT_EQ(nullptr, routes.longest_prefix_match(ip(11, 0, 0, 0)).first);
+  EXPECT_THROW(routes.route(0, 33), error::invalid_prefix_length);
+  EXPECT_THROW(routes.erase_route(0, 33), error::invalid_prefix_length);
+  EXPECT_THROW(routes.erase_route(ip(10, 1, 128, 7), 40), error::invalid_prefix_length);
+}
+
+TEST_F(IntegerTrieTest, Keys_And_Routes_Share_Paths) {
+  integer_trie<unsigned, int> routes;
+
+  /* a lone key is kept near the root until another key or route needs its slot */
+  routes[0x0a010203] = 1;
+  routes.route(0x0a010204, 32) = 2;
+  EXPECT_EQ(nullptr, routes.longest_prefix_match(0x0a010205).first);
+  EXPECT_EQ(2, *routes.longest_prefix_match(0x0a010204).first);
+
+  routes.route(0x0a010203, 24) = 3;
+  routes.route(0x0a010203, 32) = 4;
+  EXPECT_EQ(3, *routes.longest_prefix_match(0x0a010205).first);
+  EXPECT_EQ(4, *routes.longest_prefix_match(0x0a010203).first);
+  EXPECT_EQ(1, routes[0x0a010203]);
+  EXPECT_EQ(1, routes.size());
+
+  EXPECT_EQ(1, routes.erase(0x0a010203));
+  EXPECT_EQ(4, *routes.longest_prefix_match(0x0a010203).first);
+  EXPECT_EQ(routes.end(), routes.begin());
+  EXPECT_EQ(1, routes.erase_route(0x0a010203, 32));
+  EXPECT_EQ(3, *routes.longest_prefix_match(0x0a010203).first);
+
+  routes[0x0a0102ff] = 5;
+  routes[0x0b000000] = 6;
+  EXPECT_EQ(0x0a0102ff, routes.lower_bound(0x0a010205)->key());
+  EXPECT_EQ(0x0b000000, routes.lower_bound(0x0a010300)->key());
+  EXPECT_EQ(routes.end(), routes.lower_bound(0x0b000001));
+}
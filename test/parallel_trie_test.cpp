@@ -0,0 +1,112 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include "../src/parallel_trie.h"
+
+static const std::string _alpha =
+  "abcdefghijklmnopqrstuvwxyz"
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  "1234567890";
+
+class ParallelTrieTest : public ::testing::Test {
+public:
+  trie<char, int> _trie;
+  work_stealing_pool _pool;
+
+  ParallelTrieTest() : _trie(_alpha), _pool(4) {
+    std::mt19937 gen(3);
+    _trie[""] = 0;
+    for (int i = 1; i < 20000; ++i) {
+      std::string key(gen() % 10, ' ');
+      for (auto &ch : key)
+        ch = _alpha[gen() % 8];
+      _trie[key] = i;
+    }
+  }
+};
+
+TEST_F(ParallelTrieTest, Pool_Runs_Every_Task) {
+  std::vector<std::atomic<int>> runs(1000);
+  for (auto &it : runs)
+    it = 0;
+  _pool.run(runs.size(), [&](size_t i) { ++runs[i]; });
+  for (auto &it : runs)
+    EXPECT_EQ(1, it);
+
+  EXPECT_THROW(_pool.run(10, [](size_t i) {
+    if (i == 7)
+      throw std::runtime_error("task failed");
+  }), std::runtime_error);
+  _pool.run(0, [](size_t) { FAIL(); });
+}
+
+TEST_F(ParallelTrieTest, For_Each_Visits_Every_Value) {
+  std::vector<int> before;
+  before.push_back(_trie.at(""));
+  for (auto &node : _trie)
+    before.push_back(node.value());
+
+  std::atomic<long long> sum(0);
+  std::atomic<size_t> count(0);
+  parallel_for_each(_trie, [&](trie<char, int>::reference node) {
+    sum += node.value();
+    ++count;
+    node.value() *= 2;
+  }, _pool);
+
+  EXPECT_EQ(before.size(), count);
+  EXPECT_EQ(std::accumulate(before.begin(), before.end(), 0ll), sum);
+  EXPECT_EQ(2 * before[0], _trie.at(""));
+  size_t i = 1;
+  for (auto &node : _trie)
+    EXPECT_EQ(2 * before[i++], node.value());
+}
+
+TEST_F(ParallelTrieTest, Reduce_And_Transform_Follow_Key_Order) {
+  const auto &reader = _trie;
+  std::vector<std::string> keys(1, "");
+  for (auto &node : reader)
+    keys.push_back(node.key<std::string>());
+
+  auto key_of = [](trie<char, int>::const_reference node) { return node.key<std::string>(); };
+  std::vector<std::string> transformed;
+  parallel_transform(reader, key_of, std::back_inserter(transformed), _pool);
+  EXPECT_EQ(keys, transformed);
+
+  /* concatenation is associative but not commutative */
+  auto concatenated = parallel_reduce(reader, std::string(), [](trie<char, int>::const_reference node) {
+    return node.key<std::string>() + ",";
+  }, [](const std::string &left, const std::string &right) { return left + right; }, _pool);
+  std::string expected;
+  for (auto &it : keys)
+    expected += it + ",";
+  EXPECT_EQ(expected, concatenated);
+
+  auto any_of = [&](int value) {
+    return parallel_reduce(reader, false, [=](trie<char, int>::const_reference node) { return node.value() == value; },
+      [](bool left, bool right) { return left || right; }, _pool);
+  };
+  EXPECT_TRUE(any_of(19999));
+  EXPECT_FALSE(any_of(-1));
+}
+
+TEST_F(ParallelTrieTest, Empty_Trie) {
+  trie<char, int> empty(_alpha);
+  std::atomic<int> count(0);
+  parallel_for_each(empty, [&](trie<char, int>::reference) { ++count; }, _pool);
+  EXPECT_EQ(0, count);
+  EXPECT_EQ(0, parallel_reduce(empty, 0, [](trie<char, int>::reference node) { return node.value(); },
+    [](int left, int right) { return left + right; }));
+
+  empty[""] = 5;
+  EXPECT_EQ(5, parallel_reduce(empty, 0, [](trie<char, int>::reference node) { return node.value(); },
+    [](int left, int right) { return left + right; }, _pool));
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include "../src/pattern.h"
+#include <algorithm>
+#include <map>
+#include <random>
+#include <regex>
+
+static const std::string _alpha =
+  "abcdefghijklmnopqrstuvwxyz"
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  "1234567890";
+
+typedef trie<char, int> trie_type;
+typedef trie_pattern<trie_type> pattern_type;
+
+class PatternTest : public ::testing::Test {
+public:
+  trie_type _trie;
+
+  PatternTest() : _trie(_alpha) {
+    _trie["panda"] = 1;
+    _trie["pandas"] = 2;
+    _trie["polar"] = 3;
+    _trie["koala"] = 4;
+    _trie["grizzly"] = 5;
+    _trie["bear1"] = 6;
+    _trie["bear22"] = 7;
+    _trie["be4r"] = 8;
+  }
+
+  std::vector<std::string> glob(const std::string &expr) {
+    return keys(pattern_type::glob(expr, _trie));
+  }
+
+  std::vector<std::string> regex(const std::string &expr) {
+    return keys(pattern_type::regex(expr, _trie));
+  }
+
+  std::vector<std::string> keys(const pattern_type &pattern) {
+    std::vector<trie_type::iterator> matches;
+    _trie.match(pattern, std::back_inserter(matches));
+    std::vector<std::string> result;
+    for (auto &it : matches)
+      result.push_back(it->key<std::string>());
+    return result;
+  }
+};
+
+TEST_F(PatternTest, Glob_Literal) {
+  EXPECT_EQ(std::vector<std::string>({ "panda" }), glob("panda"));
+  EXPECT_EQ(std::vector<std::string>(), glob("pand"));
+}
+
+TEST_F(PatternTest, Glob_Wildcards) {
+  EXPECT_EQ(std::vector<std::string>({ "panda", "polar" }), glob("p????"));
+  EXPECT_EQ(std::vector<std::string>({ "panda", "pandas", "polar" }), glob("p*"));
+  EXPECT_EQ(std::vector<std::string>({ "pandas", "polar" }), glob("*a?"));
+  EXPECT_EQ(std::vector<std::string>({ "koala", "panda" }), glob("*a"));
+  EXPECT_EQ(std::vector<std::string>({ "bear1", "bear22" }), glob("bea*r*"));
+  EXPECT_EQ(8, glob("*").size());
+}
+
+TEST_F(PatternTest, Glob_Classes) {
+  EXPECT_EQ(std::vector<std::string>({ "bear1", "bear22" }), glob("bear[0-9]*"));
+  EXPECT_EQ(std::vector<std::string>({ "be4r" }), glob("??[0-9]*"));
+  EXPECT_EQ(std::vector<std::string>({ "panda", "polar" }), glob("p[!r-z]*[ar]"));
+  EXPECT_EQ(std::vector<std::string>({ "koala", "polar" }), glob("[kp]o*"));
+}
+
+TEST_F(PatternTest, Regex) {
+  EXPECT_EQ(std::vector<std::string>({ "panda", "pandas" }), regex("pandas?"));
+  EXPECT_EQ(std::vector<std::string>({ "bear1", "bear22" }), regex("bear[0-9]+"));
+  EXPECT_EQ(std::vector<std::string>({ "be4r", "bear1", "bear22" }), regex("b.*"));
+  EXPECT_EQ(std::vector<std::string>({ "grizzly" }), regex("griz*ly"));
+  EXPECT_EQ(std::vector<std::string>({ "bear22" }), regex("bear[^1]2"));
+}
+
+TEST_F(PatternTest, Agrees_With_Brute_Force) {
+  /* nodes near the root have more children than a class has symbols, nodes further down fewer */
+  std::mt19937 gen(9);
+  for (int i = 0; i < 3000; ++i) {
+    std::string key(1 + gen() % 5, ' ');
+    for (auto &ch : key)
+      ch = _alpha[gen() % _alpha.size()];
+    _trie[key] = i;
+  }
+
+  for (auto &expr : { "a?[0-9]*", "[a-c]?", "*z", "?[xyz]?[0-9]", "[0-9]*[a-e]" }) {
+    std::string translated;
+    for (const char *ch = expr; *ch; ++ch)
+      translated += *ch == '?' ? std::string(".") : *ch == '*' ? std::string(".*") : std::string(1, *ch);
+    std::regex expected(translated);
+    std::vector<std::string> brute;
+    for (auto &node : _trie)
+      if (std::regex_match(node.key<std::string>(), expected))
+        brute.push_back(node.key<std::string>());
+    EXPECT_EQ(brute, glob(expr)) << expr;
+  }
+}
+
+TEST_F(PatternTest, Symbols_Outside_Alphabet) {
+  EXPECT_EQ(std::vector<std::string>(), glob("pan-a"));
+  EXPECT_EQ(std::vector<std::string>({ "panda" }), glob("pan[-d]a"));
+  EXPECT_EQ(std::vector<std::string>(), regex("panda\\."));
+}
+
+TEST_F(PatternTest, Invalid) {
+  EXPECT_THROW(glob("pan[da"), error::invalid_pattern);
+  EXPECT_THROW(glob("panda\\"), error::invalid_pattern);
+  EXPECT_THROW(regex("*panda"), error::invalid_pattern);
+  EXPECT_THROW(regex("panda+?"), error::invalid_pattern);
+}
@@ -1,14 +1,30 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 #include <chrono>
 #include <random>
 #include <windows.h>
 #include <psapi.h>
 #include <iostream>
 #include <algorithm>
+#include <regex>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <gtest/gtest.h>
 #include "../src/trie.h"
+#include "../src/aho_corasick.h"
+#include "../src/pattern.h"
+#include "../src/utf8_trie.h"
+#include "../src/integer_trie.h"
+#include "../src/dawg.h"
+#include "../src/trie_stats.h"
+#include "../src/durable_trie.h"
+#include "../src/parallel_trie.h"
 
 static const std::string _alpha =
   "abcdefghijklmnopqrstuvwxyz"
@@ -38,6 +54,19 @@ public:
       std::cout << "\tMemory: " << (mem_end.PeakWorkingSetSize - mem_start.PeakWorkingSetSize) / 1024 << "kb\n";
   }
 
+  /* the memory still held after pred returns, for structures that outlive it */
+  template <class PredT>
+  void measure_resident(const PredT &pred) {
+    PROCESS_MEMORY_COUNTERS mem_start, mem_end;
+    GetProcessMemoryInfo(GetCurrentProcess(), &mem_start, sizeof mem_start);
+    measure_time(pred);
+    GetProcessMemoryInfo(GetCurrentProcess(), &mem_end, sizeof mem_end);
+    if (mem_end.WorkingSetSize < mem_start.WorkingSetSize)
+      std::cout << "\tResident: no increase\n";
+    else
+      std::cout << "\tResident: " << (mem_end.WorkingSetSize - mem_start.WorkingSetSize) / 1024 << "kb\n";
+  }
+
   template <class PredT>
   void measure(const PredT &pred) {
     measure_memory([&]()
@@ -80,6 +109,17 @@ public:
     return uniform(min, max);
   }
 
+  /* output iterator that only counts what is written to it */
+  struct counter : std::iterator<std::output_iterator_tag, void, void, void, void> {
+    size_t &_count;
+    explicit counter(size_t &count) : _count(count) {}
+    template <class T>
+    counter &operator=(const T &) { ++_count; return *this; }
+    counter &operator*() { return *this; }
+    counter &operator++() { return *this; }
+    counter operator++(int) { return *this; }
+  };
+
   int uniform(int min, int max) {
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -209,18 +249,692 @@ TEST_F(PerformanceTest, Heavy_Retrieval_Prefixes) {
   std::random_shuffle(_keys.begin(), _keys.end());
 
   const int iterations = 10;
+  const auto &_reader = _trie;
+  long long _sum = 0;
 
   std::cout << "Map:\n";
   measure([&]() {
     for (int i = 0; i < iterations; ++i)
       for (auto &it : _keys)
-        auto val = _map[it];
+        _sum += _map.find(it)->second;
   });
 
   std::cout << "Trie:\n";
   measure([&]() {
     for (int i = 0; i < iterations; ++i)
       for (auto &it : _keys)
-        auto val = _trie[it];
+        _sum -= *_reader.try_get(it);
+  });
+
+  EXPECT_EQ(0, _sum);
+}
+
+TEST_F(PerformanceTest, Multi_Pattern_Scan) {
+  const int _patterns = 10000;
+  const int _max_len = 8;
+  const int _text_len = 1000000;
+  auto _keys = random_string_set(_patterns, _max_len);
+  std::string _text;
+  std::mt19937 gen(std::random_device{}());
+  for (int i = 0; i < _text_len; ++i)
+    _text += _alpha[gen() % _alpha.size()];
+
+  trie<char, int> _trie(_alpha);
+  for (auto &_key : _keys)
+    _trie[_key] = 10;
+
+  size_t expected = 0;
+  std::cout << "Trie, prefixes_of at every offset:\n";
+  measure([&]() {
+    for (auto it = _text.begin(); it != _text.end(); ++it)
+      _trie.prefixes_of(it, _text.end(), counter(expected));
+  });
+
+  aho_corasick<trie<char, int>> _sparse(_trie);
+  size_t actual = 0;
+  std::cout << "Aho-Corasick, sparse:\n";
+  measure([&]() {
+    _sparse.scan(_text, [&](size_t, trie<char, int>::iterator) { ++actual; });
+  });
+  EXPECT_EQ(expected, actual);
+
+  aho_corasick<trie<char, int>> _dense(_trie, aho_corasick<trie<char, int>>::dense);
+  actual = 0;
+  std::cout << "Aho-Corasick, dense:\n";
+  measure([&]() {
+    _dense.scan(_text, [&](size_t, trie<char, int>::iterator) { ++actual; });
+  });
+  EXPECT_EQ(expected, actual);
+}
+
+TEST_F(PerformanceTest, Fuzzy_Find) {
+  const int _words = 1000000;
+  const int _queries = 100;
+  const std::string _lower = "abcdefghijklmnopqrstuvwxyz";
+
+  std::mt19937 gen(std::random_device{}());
+  auto word = [&]() {
+    std::string result(3 + gen() % 8, ' ');
+    for (auto &ch : result)
+      ch = _lower[gen() % _lower.size()];
+    return result;
+  };
+
+  std::vector<std::string> _keys;
+  trie<char, int> _trie(_lower);
+  for (int i = 0; i < _words; ++i) {
+    _keys.push_back(word());
+    _trie[_keys.back()] = 10;
+  }
+  std::sort(_keys.begin(), _keys.end());
+  _keys.erase(std::unique(_keys.begin(), _keys.end()), _keys.end());
+
+  std::vector<std::string> _query;
+  for (int i = 0; i < _queries; ++i)
+    _query.push_back(_keys[gen() % _keys.size()]);
+
+  auto distance = [](const std::string &a, const std::string &b) {
+    std::vector<size_t> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j)
+      row[j] = j;
+    for (size_t i = 1; i <= a.size(); ++i) {
+      size_t diagonal = row[0];
+      row[0] = i;
+      for (size_t j = 1; j <= b.size(); ++j) {
+        size_t above = row[j];
+        row[j] = (std::min)((std::min)(row[j], row[j - 1]) + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1));
+        diagonal = above;
+      }
+    }
+    return row[b.size()];
+  };
+
+  for (size_t max = 1; max <= 2; ++max) {
+    size_t expected = 0, actual = 0;
+
+    std::cout << "Brute force, distance " << max << ":\n";
+    measure([&]() {
+      for (auto &query : _query)
+        for (auto &key : _keys)
+          if (distance(query, key) <= max)
+            ++expected;
+    });
+
+    std::cout << "Trie, distance " << max << ":\n";
+    measure([&]() {
+      for (auto &query : _query)
+        _trie.fuzzy_find(query, max, counter(actual));
+    });
+
+    EXPECT_EQ(expected, actual);
+  }
+}
+
+TEST_F(PerformanceTest, Pattern_Match) {
+  const int _words = 150000;
+  const int _max_len = 26;
+  const std::string _expr = "a?[0-9]*z";
+  auto _keys = random_string_set(_words, _max_len);
+
+  trie<char, int> _trie(_alpha);
+  for (auto &_key : _keys)
+    _trie[_key] = 10;
+
+  size_t expected = 0, actual = 0;
+  std::regex _regex("a.[0-9].*z");
+
+  std::cout << "Trie, iterate and filter:\n";
+  measure([&]() {
+    for (auto &it : _trie)
+      if (std::regex_match(it.key<std::string>(), _regex))
+        ++expected;
+  });
+
+  std::cout << "Trie, match:\n";
+  measure([&]() {
+    _trie.match(trie_pattern<trie<char, int>>::glob(_expr, _trie), counter(actual));
+  });
+
+  EXPECT_EQ(expected, actual);
+}
+
+TEST_F(PerformanceTest, Wide_Insert) {
+  const int _words = 150000;
+  const int _symbols = 3000;
+
+  std::wstring _wide;
+  for (int i = 0; i < _symbols; ++i)
+    _wide += wchar_t(0x4e00 + i);
+
+  std::mt19937 gen(std::random_device{}());
+  std::vector<std::wstring> _keys;
+  for (int i = 0; i < _words; ++i) {
+    std::wstring key(1 + gen() % 8, L' ');
+    for (auto &ch : key)
+      ch = _wide[gen() % _wide.size()];
+    _keys.push_back(key);
+  }
+
+  std::map<std::wstring, int> _map;
+  std::cout << "Map:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _map[_key] = 10;
+  });
+
+  trie<wchar_t, int> _trie(_wide);
+  std::cout << "Trie:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _trie[_key] = 10;
+  });
+
+  size_t found = 0;
+  std::cout << "Map, find:\n";
+  measure_time([&]() {
+    for (auto &_key : _keys)
+      found += _map.find(_key) != _map.end();
+  });
+
+  std::cout << "Trie, find:\n";
+  measure_time([&]() {
+    for (auto &_key : _keys)
+      found += _trie.has(_key);
+  });
+  EXPECT_EQ(2 * _keys.size(), found);
+
+  /* the same keys under an alphabet of dense_limit symbols, and of one symbol more, which is past the threshold */
+  std::wstring _dense = _wide.substr(0, trie_children<void>::dense_limit);
+  std::wstring _sparse = _wide.substr(0, trie_children<void>::dense_limit + 1);
+  for (auto &_key : _keys)
+    for (auto &ch : _key)
+      ch = _dense[ch % _dense.size()];
+
+  for (auto *_alphabet : { &_sparse, &_dense }) {
+    const char *_name = _alphabet == &_dense ? "Dense" : "Sparse";
+    trie<wchar_t, int> _narrow(*_alphabet);
+    std::cout << _name << " children:\n";
+    measure_resident([&]() {
+      for (auto &_key : _keys)
+        _narrow[_key] = 10;
+    });
+
+    found = 0;
+    std::cout << _name << " children, find:\n";
+    measure_time([&]() {
+      for (auto &_key : _keys)
+        found += _narrow.has(_key);
+    });
+    EXPECT_EQ(_keys.size(), found);
+  }
+}
+
+TEST_F(PerformanceTest, Utf8_Insert_Retrieval) {
+  const int _words = 150000;
+  const int _symbols = 3000;
+
+  std::wstring _wide;
+  for (int i = 0; i < _symbols; ++i)
+    _wide += wchar_t(0x4e00 + i);
+
+  std::mt19937 gen(std::random_device{}());
+  std::vector<std::wstring> _keys;
+  std::vector<std::string> _utf8;
+  for (int i = 0; i < _words; ++i) {
+    std::u32string key(1 + gen() % 8, U' ');
+    for (auto &ch : key)
+      ch = _wide[gen() % _wide.size()];
+    _keys.push_back(std::wstring(key.begin(), key.end()));
+    _utf8.push_back(utf8::encode(key));
+  }
+
+  trie<wchar_t, int> _trie(_wide);
+  std::cout << "Trie, wchar_t:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _trie[_key] = 10;
+    for (auto &_key : _keys)
+      _trie.has(_key);
+  });
+
+  utf8_trie<int> _bytes;
+  std::cout << "Trie, UTF-8:\n";
+  measure([&]() {
+    for (auto &_key : _utf8)
+      _bytes[_key] = 10;
+    for (auto &_key : _utf8)
+      _bytes.has(_key);
+  });
+}
+
+TEST_F(PerformanceTest, Integer_Keys) {
+  const int _count = 1000000;
+
+  std::mt19937_64 gen(std::random_device{}());
+  std::vector<unsigned long long> _keys;
+  for (int i = 0; i < _count; ++i)
+    _keys.push_back(gen());
+
+  std::map<unsigned long long, int> _map;
+  std::unordered_map<unsigned long long, int> _hash;
+  integer_trie<unsigned long long, int> _trie;
+  unsigned long long _sum = 0;
+
+  std::cout << "Insert, map:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _map[_key] = 10;
+  });
+
+  std::cout << "Insert, unordered_map:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _hash[_key] = 10;
+  });
+
+  std::cout << "Insert, integer_trie:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _trie[_key] = 10;
+  });
+
+  std::shuffle(_keys.begin(), _keys.end(), gen);
+
+  std::cout << "Find, map:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _sum += _map.find(_key)->second;
+  });
+
+  std::cout << "Find, unordered_map:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _sum += _hash.find(_key)->second;
+  });
+
+  std::cout << "Find, integer_trie:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _sum += _trie.find(_key)->value();
+  });
+
+  std::cout << "Lower bound, map:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _sum += _map.lower_bound(_key ^ 1)->first & 1;
+  });
+
+  std::cout << "Lower bound, integer_trie:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _sum += _trie.lower_bound(_key ^ 1)->key() & 1;
+  });
+
+  std::cout << "Iterate, map:\n";
+  measure([&]() {
+    for (auto &it : _map)
+      _sum += it.second;
+  });
+
+  std::cout << "Iterate, integer_trie:\n";
+  measure([&]() {
+    for (auto &it : _trie)
+      _sum += it.value();
+  });
+
+  EXPECT_NE(0, _sum);
+}
+
+TEST_F(PerformanceTest, Merge_Shards) {
+  const int _shards = 32;
+  const int _words = 20000;
+
+  /* shards of a common vocabulary, so most keys are in several of them */
+  std::vector<std::string> _vocabulary = random_string_set(_words * 4, 12);
+  std::mt19937 gen(std::random_device{}());
+  std::vector<std::vector<std::string>> _keys(_shards);
+  for (auto &keys : _keys)
+    for (int i = 0; i < _words; ++i)
+      keys.push_back(_vocabulary[gen() % _vocabulary.size()]);
+
+  auto build = [&](std::vector<std::unique_ptr<trie<char, int>>> &shards) {
+    for (auto &keys : _keys) {
+      shards.emplace_back(new trie<char, int>(_alpha));
+      for (auto &_key : keys)
+        (*shards.back())[_key] += 1;
+    }
+  };
+
+  std::vector<std::unique_ptr<trie<char, int>>> _copied, _merged;
+  build(_copied);
+  build(_merged);
+  size_t _copied_size = 0, _merged_size = 0;
+
+  std::cout << "Trie, iterate and insert:\n";
+  measure([&]() {
+    trie<char, int> _trie(_alpha);
+    for (auto &shard : _copied) {
+      for (auto &it : *shard)
+        _trie[it.key<std::string>()] += it.value();
+      shard.reset();
+    }
+    _copied_size = _trie.size();
+  });
+
+  std::cout << "Trie, merge:\n";
+  measure([&]() {
+    trie<char, int> _trie(_alpha);
+    for (auto &shard : _merged)
+      _trie.merge(std::move(*shard), [](int mine, int theirs) { return mine + theirs; });
+    _merged_size = _trie.size();
+  });
+
+  EXPECT_EQ(_copied_size, _merged_size);
+}
+
+TEST_F(PerformanceTest, Dawg_Key_Set) {
+  const int _stems = 200000;
+  const std::vector<std::string> _suffixes = { "", "s", "ed", "ing", "er", "ers" };
+
+  std::vector<std::string> _keys;
+  for (auto &stem : random_string_set(_stems, 8))
+    for (auto &suffix : _suffixes)
+      _keys.push_back(stem + suffix);
+  std::sort(_keys.begin(), _keys.end());
+  _keys.erase(std::unique(_keys.begin(), _keys.end()), _keys.end());
+
+  size_t _found = 0;
+
+  std::cout << "Trie, insert:\n";
+  trie<char, bool> _trie(_alpha);
+  measure([&]() {
+    for (auto &_key : _keys)
+      _trie[_key] = true;
+  });
+
+  std::cout << "Dawg, insert sorted:\n";
+  dawg<char> _dawg(_alpha);
+  measure([&]() {
+    for (auto &_key : _keys)
+      _dawg.insert(_key);
+    _dawg.finish();
+  });
+  std::cout << "\tKeys: " << _keys.size() << ", states: " << _dawg.states() << ", transitions: " << _dawg.transitions() << "\n";
+
+  std::cout << "Trie, has:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _found += _trie.has(_key);
+  });
+
+  std::cout << "Dawg, has:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _found += _dawg.has(_key);
+  });
+
+  EXPECT_EQ(_keys.size() * 2, _found);
+}
+
+TEST_F(PerformanceTest, Erase_Prefix) {
+  const int _tenants = 1000;
+  const int _words = 500;
+
+  std::vector<std::string> _prefixes;
+  for (int i = 0; i < _tenants; ++i)
+    _prefixes.push_back(std::to_string(1000000 + i) + "x");
+
+  std::vector<std::vector<std::string>> _keys;
+  for (auto &prefix : _prefixes) {
+    _keys.push_back(std::vector<std::string>());
+    for (auto &word : random_string_set(_words, 10))
+      _keys.back().push_back(prefix + word);
+  }
+
+  trie<char, int> _erased(_alpha), _detached(_alpha);
+  for (auto &keys : _keys)
+    for (auto &_key : keys) {
+      _erased[_key] = 1;
+      _detached[_key] = 1;
+    }
+
+  std::cout << "Trie, erase each key:\n";
+  measure([&]() {
+    for (int i = 0; i < _tenants; i += 5)
+      for (auto &_key : _keys[i])
+        _erased.erase(_key);
+  });
+
+  std::cout << "Trie, erase_prefix:\n";
+  measure([&]() {
+    for (int i = 0; i < _tenants; i += 5)
+      _detached.erase_prefix(_prefixes[i]);
+  });
+
+  EXPECT_EQ(_erased.size(), _detached.size());
+}
+
+TEST_F(PerformanceTest, Compact_Random_Lookup) {
+  const int _words = 400000;
+  const int _lookups = 2000000;
+  const std::string _digits = "0123456789";
+
+  std::mt19937 gen(std::random_device{}());
+  std::vector<std::string> _keys;
+  for (int i = 0; i < _words; ++i) {
+    std::string key(12, ' ');
+    for (auto &ch : key)
+      ch = _digits[gen() % _digits.size()];
+    _keys.push_back(key);
+  }
+
+  /* interleaved inserts and erases scatter the surviving nodes across the heap */
+  trie<char, int> _trie(_digits);
+  for (int i = 0; i < _words; ++i) {
+    _trie[_keys[i]] = i;
+    if (i % 2)
+      _trie.erase(_keys[gen() % (i + 1)]);
+  }
+
+  std::vector<std::string> _queries;
+  for (int i = 0; i < _lookups; ++i)
+    _queries.push_back(_keys[gen() % _keys.size()]);
+
+  size_t _before = 0, _after = 0;
+
+  std::cout << "Trie, scattered:\n";
+  measure([&]() {
+    for (auto &_query : _queries)
+      _before += _trie.has(_query);
+  });
+
+  std::cout << "Trie, compact:\n";
+  measure([&]() {
+    _trie.compact();
+  });
+
+  std::cout << "Trie, compacted:\n";
+  measure([&]() {
+    for (auto &_query : _queries)
+      _after += _trie.has(_query);
+  });
+
+  EXPECT_EQ(_before, _after);
+}
+
+TEST_F(PerformanceTest, Cache_Zipfian_Lookup) {
+  const int _words = 100000;
+  const int _lookups = 5000000;
+  const std::string _digits = "0123456789";
+
+  std::mt19937 gen(std::random_device{}());
+  std::vector<std::string> _keys;
+  for (int i = 0; i < _words; ++i) {
+    std::string key(16, ' ');
+    for (auto &ch : key)
+      ch = _digits[gen() % _digits.size()];
+    _keys.push_back(key);
+  }
+
+  /* the key of rank r is looked up in proportion to 1 / r */
+  std::vector<double> _weights;
+  for (int i = 1; i <= _words; ++i)
+    _weights.push_back(1.0 / i);
+  std::discrete_distribution<int> zipf(_weights.begin(), _weights.end());
+  std::vector<const std::string *> _queries;
+  for (int i = 0; i < _lookups; ++i)
+    _queries.push_back(&_keys[zipf(gen)]);
+
+  trie<char, int> _trie(_digits);
+  for (auto &_key : _keys)
+    _trie[_key] = 1;
+
+  size_t _plain = 0, _cached = 0;
+
+  std::cout << "Trie:\n";
+  measure([&]() {
+    for (auto _query : _queries)
+      _plain += _trie.has(*_query);
   });
+
+  std::cout << "Trie, 65536 entry cache:\n";
+  _trie.enable_cache(65536);
+  measure([&]() {
+    for (auto _query : _queries)
+      _cached += _trie.has(*_query);
+  });
+  std::cout << "\tHits: " << _trie.cache()->hits() << ", misses: " << _trie.cache()->misses() << "\n";
+
+  EXPECT_EQ(_plain, _cached);
+}
+
+TEST_F(PerformanceTest, Instrumentation_Overhead) {
+  const int _words = 200000;
+  auto _keys = random_string_set(_words, 12);
+
+  trie<char, int> _plain(_alpha);
+  trie<char, int, std::less<char>, trie_stats<>> _counted(_alpha);
+  size_t _found = 0;
+
+  std::cout << "Trie, no_stats:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _plain[_key] = 1;
+    for (auto &_key : _keys)
+      _found += _plain.has(_key);
+  });
+
+  std::cout << "Trie, trie_stats:\n";
+  measure([&]() {
+    for (auto &_key : _keys)
+      _counted[_key] = 1;
+    for (auto &_key : _keys)
+      _found += _counted.has(_key);
+  });
+
+  const trie_counters &x = trie_stats<>::counters();
+  std::cout << "\tFind p50 <= " << x.latency_of(trie_operation::find).percentile(0.5)
+    << "ns, p99 <= " << x.latency_of(trie_operation::find).percentile(0.99)
+    << "ns, mean depth " << double(x.traversed_nodes) / x.traversals << "\n";
+
+  EXPECT_EQ(_keys.size() * 2, _found);
+}
+
+TEST_F(PerformanceTest, Durable_Write_Throughput) {
+  typedef durable_trie<trie<char, int>> durable;
+  const std::string _path = "durable_trie_benchmark";
+  const int _words = 50000;
+  auto _keys = random_string_set(_words, 12);
+  durable::destroy(_path);
+
+  std::cout << "Trie:\n";
+  measure([&]() {
+    trie<char, int> _trie(_alpha);
+    for (auto &_key : _keys)
+      _trie.insert(_key, 1);
+  });
+
+  for (size_t group : { 4096, 64 }) {
+    durability_options options;
+    options.group_size = group;
+    std::cout << "Durable trie, fsync every " << group << " writes:\n";
+    measure([&]() {
+      durable _trie(_path, _alpha, options);
+      for (auto &_key : _keys)
+        _trie.assign(_key, 1);
+    });
+    durable::destroy(_path);
+  }
+}
+
+TEST_F(PerformanceTest, Durable_Recovery) {
+  typedef durable_trie<trie<char, int>> durable;
+  const std::string _path = "durable_trie_benchmark";
+  const int _words = 200000;
+  auto _keys = random_string_set(_words, 12);
+  durability_options options;
+  options.group_size = 4096;
+  durable::destroy(_path);
+
+  {
+    durable _trie(_path, _alpha, options);
+    for (auto &_key : _keys)
+      _trie.assign(_key, 1);
+  }
+
+  std::cout << "Rebuild by insertion:\n";
+  measure([&]() {
+    trie<char, int> _trie(_alpha);
+    for (auto &_key : _keys)
+      _trie.insert(_key, 1);
+  });
+
+  std::cout << "Recovery, log only:\n";
+  measure([&]() {
+    durable _trie(_path, _alpha, options);
+    EXPECT_EQ(_keys.size(), _trie.replayed());
+  });
+
+  {
+    durable _trie(_path, _alpha, options);
+    _trie.snapshot();
+    for (int i = 0; i < _words / 10; ++i)
+      _trie.assign(_keys[i], 2);
+  }
+
+  std::cout << "Recovery, snapshot and log tail:\n";
+  measure([&]() {
+    durable _trie(_path, _alpha, options);
+    EXPECT_EQ(size_t(_words / 10), _trie.replayed());
+  });
+
+  durable::destroy(_path);
+}
+
+TEST_F(PerformanceTest, Parallel_Scan) {
+  const int _words = 500000;
+  auto _keys = random_string_set(_words, 12);
+  trie<char, int> _trie(_alpha);
+  for (auto &_key : _keys)
+    _trie[_key] = 1;
+  long long _iterated = 0, _reduced = 0;
+
+  std::cout << "Trie, rescore and sum through the iterator:\n";
+  measure([&]() {
+    for (auto &node : _trie) {
+      node.value() = node.value() * 3 % 7;
+      _iterated += node.value();
+    }
+  });
+
+  std::cout << "Trie, rescore and sum with parallel_reduce on " << work_stealing_pool::shared().size() << " threads:\n";
+  measure([&]() {
+    _reduced = parallel_reduce(_trie, 0ll, [](trie<char, int>::reference node) {
+      node.value() = node.value() * 3 % 7;
+      return (long long)node.value();
+    }, [](long long left, long long right) { return left + right; });
+  });
+
+  /* every value went 1, 3, 2 */
+  EXPECT_EQ(_iterated / 3 * 2, _reduced);
 }
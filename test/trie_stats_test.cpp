@@ -0,0 +1,89 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include "../src/trie_stats.h"
+
+static const std::string _alpha =
+  "abcdefghijklmnopqrstuvwxyz"
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  "1234567890";
+
+struct stats_test_tag {};
+
+class TrieStatsTest : public ::testing::Test {
+public:
+  typedef trie_stats<stats_test_tag> stats;
+
+  trie<char, int, std::less<char>, stats> _trie;
+
+  TrieStatsTest() : _trie(_alpha) {
+    stats::reset();
+  }
+};
+
+TEST_F(TrieStatsTest, Counts_Operations) {
+  _trie["panda"] = 1;
+  _trie["pan"] = 2;
+  _trie.insert("polar", 3);
+
+  const trie_counters &x = stats::counters();
+  EXPECT_EQ(3, x.of(trie_operation::insert));
+  EXPECT_EQ(9, x.nodes_allocated);
+  EXPECT_EQ(13, x.traversed_nodes);
+
+  EXPECT_TRUE(_trie.has("panda"));
+  EXPECT_FALSE(_trie.has("pand"));
+  EXPECT_FALSE(_trie.has("koala"));
+  EXPECT_EQ(3, x.of(trie_operation::find));
+  EXPECT_EQ(1, x.find_hits);
+  EXPECT_EQ(2, x.find_misses);
+
+  for (auto &it : _trie)
+    (void)it;
+  EXPECT_EQ(3, x.iterator_steps);
+
+  _trie.erase("panda");
+  _trie.erase_prefix("po");
+  EXPECT_EQ(2, x.of(trie_operation::erase));
+  EXPECT_EQ(6, x.nodes_freed);
+  EXPECT_LT(0, x.index_lookups);
+
+  _trie.clear();
+  EXPECT_EQ(x.nodes_allocated, x.nodes_freed);
+}
+
+TEST_F(TrieStatsTest, Latency_Histogram) {
+  for (int i = 0; i < 100; ++i)
+    _trie.has("panda");
+
+  const latency_histogram &latency = stats::counters().latency_of(trie_operation::find);
+  EXPECT_EQ(100, latency.count);
+  unsigned long long total = 0;
+  for (auto it : latency.buckets)
+    total += it;
+  EXPECT_EQ(100, total);
+  EXPECT_LE(latency.percentile(0.5), latency.percentile(0.99));
+  EXPECT_LE(latency.mean(), latency.percentile(1.0));
+}
+
+TEST_F(TrieStatsTest, Separate_Tags) {
+  trie<char, int, std::less<char>, trie_stats<>> other(_alpha);
+  other["koala"] = 1;
+  EXPECT_EQ(0, stats::counters().of(trie_operation::insert));
+  EXPECT_LT(0, trie_stats<>::counters().of(trie_operation::insert));
+}
+
+TEST(TriePerfStatsTest, Cache_Misses) {
+  typedef trie_perf_stats<struct perf_test_tag> stats;
+  trie<char, int, std::less<char>, stats> perf_trie(_alpha);
+  for (int i = 0; i < 1000; ++i)
+    perf_trie[std::to_string(i)] = i;
+
+  const trie_counters &x = stats::counters();
+  EXPECT_EQ(1000, x.of(trie_operation::insert));
+  if (!stats::available()) {
+    EXPECT_EQ(0, x.cache_misses[int(trie_operation::insert)]);
+  }
+}
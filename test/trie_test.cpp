@@ -3,6 +3,9 @@
 #include <gtest/gtest.h>
 #include "../src/trie.h"
 #include <algorithm>
+#include <map>
+#include <random>
+#include <type_traits>
 
 static const std::string _alpha =
   "abcdefghijklmnopqrstuvwxyz"
@@ -16,6 +19,24 @@ public:
   TrieTest() : _trie(_alpha) {}
 };
 
+TEST_F(TrieTest, Node_Type) {
+  EXPECT_TRUE((std::is_same<trie_node<char, int>, trie<char, int>::value_type>::value));
+}
+
+TEST_F(TrieTest, Const_Nodes_Stay_Const) {
+  _trie["panda"] = 1;
+  const auto &reader = _trie;
+  EXPECT_TRUE((std::is_same<const trie_node<char, int> *, decltype(reader.begin()->successor())>::value));
+  EXPECT_TRUE((std::is_same<const trie_node<char, int> *, decltype(reader.find("panda")->predecessor())>::value));
+  EXPECT_TRUE((std::is_same<trie_node<char, int> *, decltype(_trie.begin()->successor())>::value));
+  EXPECT_EQ(reader.end().operator->(), reader.find("panda")->successor());
+}
+
+TEST_F(TrieTest, Not_Copyable) {
+  EXPECT_FALSE((std::is_copy_constructible<trie<char, int>>::value));
+  EXPECT_FALSE((std::is_copy_assignable<trie<char, int>>::value));
+}
+
 TEST_F(TrieTest, Basic_Insert_Retrieval) {
   _trie["panda"] = 1;
   EXPECT_EQ(1, _trie["panda"]);
@@ -223,6 +244,42 @@ TEST_F(TrieTest, Reverse_Iterate) {
   EXPECT_EQ(expected_values, actual_values);
 }
 
+TEST_F(TrieTest, Reverse_Iterate_Prefixed) {
+  _trie["p"] = 1;
+  _trie["pa"] = 2;
+  _trie["pan"] = 3;
+  _trie["po"] = 4;
+  _trie["q"] = 5;
+
+  std::vector<int> actual_values;
+  for (auto start = _trie.rbegin(), end = _trie.rend(); start != end; ++start)
+    actual_values.push_back(start->value());
+
+  EXPECT_EQ(std::vector<int>({ 5, 4, 3, 2, 1 }), actual_values);
+}
+
+TEST_F(TrieTest, Reverse_Iterate_After_Failed_Insert) {
+  _trie["a"] = 1;
+  EXPECT_THROW(_trie["bz!"], error::not_in_alphabet);
+  EXPECT_THROW(_trie.insert("c!", 2), error::not_in_alphabet);
+  _trie["bzz"] = 3;
+  EXPECT_THROW(_trie["bz!x"], error::not_in_alphabet);
+
+  std::vector<std::string> keys;
+  for (auto it = _trie.rbegin(); it != _trie.rend(); ++it)
+    keys.push_back(it->key<std::string>());
+  EXPECT_EQ(std::vector<std::string>({ "bzz", "a" }), keys);
+
+  keys.clear();
+  for (auto &node : _trie)
+    keys.push_back(node.key<std::string>());
+  EXPECT_EQ(std::vector<std::string>({ "a", "bzz" }), keys);
+
+  EXPECT_EQ(1, _trie.erase("bzz"));
+  EXPECT_EQ(1, _trie.rbegin()->value());
+  EXPECT_FALSE(_trie.has("bz"));
+}
+
 TEST_F(TrieTest, Erase_Iterator) {
   _trie["panda"] = 1;
   _trie["polar"] = 2;
@@ -275,6 +332,192 @@ TEST_F(TrieTest, Erase_Iterator_Range) {
   EXPECT_FALSE(_trie.has("panda"));
 }
 
+TEST_F(TrieTest, Erase_Prefix) {
+  _trie["p"] = 1;
+  _trie["panda"] = 2;
+  _trie["pandas"] = 3;
+  _trie["pan"] = 4;
+  _trie["polar"] = 5;
+  _trie["koala"] = 6;
+
+  EXPECT_EQ(3, _trie.erase_prefix("pan"));
+  EXPECT_EQ(3, _trie.size());
+  EXPECT_TRUE(_trie.has("p"));
+  EXPECT_TRUE(_trie.has("polar"));
+  EXPECT_FALSE(_trie.has("pandas"));
+  EXPECT_EQ(0, _trie.erase_prefix("pan"));
+  EXPECT_EQ(0, _trie.erase_prefix("grizzly"));
+
+  EXPECT_EQ(2, _trie.erase_prefix("p"));
+  EXPECT_EQ(1, _trie.size());
+  EXPECT_EQ("koala", _trie.begin()->key<std::string>());
+
+  _trie[""] = 7;
+  EXPECT_EQ(2, _trie.erase_prefix(""));
+  EXPECT_EQ(0, _trie.size());
+  EXPECT_TRUE(_trie.begin() == _trie.end());
+}
+
+TEST_F(TrieTest, Erase_Range_Agrees_With_Map) {
+  std::mt19937 gen(5);
+  for (int round = 0; round < 50; ++round) {
+    std::map<std::string, int> expected;
+    _trie.clear();
+    for (int i = 0; i < 200; ++i) {
+      std::string key(gen() % 5, ' ');
+      for (auto &ch : key)
+        ch = "abc"[gen() % 3];
+      expected[key] = i;
+      _trie[key] = i;
+    }
+    expected.erase("");
+    _trie.erase("");
+
+    std::vector<std::string> keys;
+    for (auto &it : expected)
+      keys.push_back(it.first);
+    size_t from = gen() % (keys.size() + 1), to = from + gen() % (keys.size() + 1 - from);
+
+    auto first = from < keys.size() ? _trie.find(keys[from]) : _trie.end();
+    auto last = to < keys.size() ? _trie.find(keys[to]) : _trie.end();
+    EXPECT_TRUE(last == _trie.erase(first, last));
+    expected.erase(from < keys.size() ? expected.find(keys[from]) : expected.end(), to < keys.size() ? expected.find(keys[to]) : expected.end());
+
+    std::vector<std::string> remaining;
+    for (auto &it : _trie)
+      remaining.push_back(it.key<std::string>());
+    std::vector<std::string> wanted;
+    for (auto &it : expected)
+      wanted.push_back(it.first);
+    EXPECT_EQ(wanted, remaining);
+    EXPECT_EQ(expected.size(), _trie.size());
+  }
+}
+
+TEST_F(TrieTest, Compact) {
+  std::map<std::string, int> expected;
+  std::mt19937 gen(3);
+  for (int i = 0; i < 3000; ++i) {
+    std::string key(gen() % 7, ' ');
+    for (auto &ch : key)
+      ch = _alpha[gen() % 8];
+    expected[key] = i;
+    _trie[key] = i;
+  }
+
+  auto agrees = [&]() {
+    EXPECT_EQ(expected.size(), _trie.size());
+    auto it = expected.begin();
+    if (_trie.has("") && it != expected.end() && it->first.empty())
+      ++it;
+    for (auto &node : _trie) {
+      ASSERT_TRUE(it != expected.end());
+      EXPECT_EQ(it->first, node.key<std::string>());
+      EXPECT_EQ(it->second, node.value());
+      ++it;
+    }
+    EXPECT_TRUE(it == expected.end());
+  };
+
+  _trie.compact();
+  agrees();
+
+  /* compacted nodes and tables are still inserted into, erased and compacted again */
+  for (int i = 0; i < 3000; ++i) {
+    std::string key(1 + gen() % 6, ' ');
+    for (auto &ch : key)
+      ch = _alpha[gen() % 10];
+    if (i % 3) {
+      expected[key] = -i;
+      _trie[key] = -i;
+    } else {
+      expected.erase(key);
+      _trie.erase(key);
+    }
+  }
+  agrees();
+
+  _trie.compact();
+  _trie.erase_prefix("a");
+  for (auto it = expected.begin(); it != expected.end();)
+    it = it->first[0] == 'a' ? expected.erase(it) : ++it;
+  _trie.compact();
+  agrees();
+
+  trie<char, int> other(_alpha);
+  other["zzz"] = 1;
+  other.compact();
+  _trie.merge(std::move(other));
+  expected["zzz"] = 1;
+  agrees();
+}
+
+TEST_F(TrieTest, Cache) {
+  _trie.enable_cache(64);
+  _trie["panda"] = 1;
+  _trie["pandas"] = 2;
+
+  EXPECT_TRUE(_trie.has("panda"));
+  EXPECT_TRUE(_trie.has("panda"));
+  EXPECT_EQ(1, _trie.find("panda")->value());
+  EXPECT_FALSE(_trie.has("pand"));
+  EXPECT_FALSE(_trie.has("pand"));
+  EXPECT_EQ(2, _trie.cache()->hits());
+  EXPECT_EQ(5, _trie.cache()->misses());
+
+  _trie["panda"] = 3;
+  EXPECT_EQ(3, _trie.cache()->hits());
+  EXPECT_EQ(3, _trie.find("panda")->value());
+
+  _trie.erase("panda");
+  EXPECT_FALSE(_trie.has("panda"));
+  EXPECT_TRUE(_trie.has("pandas"));
+  _trie.erase(_trie.find("pandas"));
+  EXPECT_FALSE(_trie.has("pandas"));
+
+  _trie["koala"] = 4;
+  EXPECT_TRUE(_trie.has("koala"));
+  _trie.erase_prefix("k");
+  EXPECT_FALSE(_trie.has("koala"));
+
+  _trie["polar"] = 5;
+  EXPECT_TRUE(_trie.has("polar"));
+  _trie.compact();
+  EXPECT_EQ(5, _trie.find("polar")->value());
+  _trie.clear();
+  EXPECT_FALSE(_trie.has("polar"));
+
+  _trie.disable_cache();
+  EXPECT_EQ(nullptr, _trie.cache());
+}
+
+TEST_F(TrieTest, Cache_Agrees_Without_Cache) {
+  trie<char, int> cached(_alpha);
+  cached.enable_cache(16);
+  std::mt19937 gen(9);
+  for (int i = 0; i < 20000; ++i) {
+    std::string key(gen() % 4, ' ');
+    for (auto &ch : key)
+      ch = "abc"[gen() % 3];
+    switch (gen() % 4) {
+    case 0:
+      _trie[key] = i;
+      cached[key] = i;
+      break;
+    case 1:
+      _trie.erase(key);
+      cached.erase(key);
+      break;
+    default:
+      ASSERT_EQ(_trie.has(key), cached.has(key)) << key;
+      if (_trie.has(key)) {
+        ASSERT_EQ(_trie.find(key)->value(), cached.find(key)->value()) << key;
+      }
+    }
+  }
+  EXPECT_LT(0, cached.cache()->hits());
+}
+
 TEST_F(TrieTest, Clear) {
   _trie["panda"] = 1;
   _trie["polar"] = 2;
@@ -304,6 +547,315 @@ TEST_F(TrieTest, Insert_Retrieve_Empty_String) {
   EXPECT_EQ(1, _trie.end()->value());
 }
 
+TEST_F(TrieTest, Pointer_Length_Lookup) {
+  const char buffer[] = "pandapolar";
+  _trie["panda"] = 1;
+  _trie["polar"] = 2;
+
+  EXPECT_TRUE(_trie.has(buffer, 5));
+  EXPECT_TRUE(_trie.has(buffer + 5, 5));
+  EXPECT_FALSE(_trie.has(buffer, 4));
+  EXPECT_EQ(2, _trie.find(buffer + 5, 5)->value());
+  EXPECT_FALSE(_trie.has(buffer + 1, 3));
+}
+
+TEST_F(TrieTest, Iterator_Range_Lookup) {
+  std::vector<char> buffer = { 'k', 'o', 'a', 'l', 'a', 's' };
+  _trie["koala"] = 3;
+
+  EXPECT_TRUE(_trie.has(buffer.begin(), buffer.end() - 1));
+  EXPECT_FALSE(_trie.has(buffer.begin(), buffer.end()));
+  EXPECT_EQ(3, _trie.find(buffer.cbegin(), buffer.cend() - 1)->value());
+}
+
+TEST_F(TrieTest, Null_Terminated_Lookup) {
+  const char key[] = "pan\0da";
+  _trie["pan"] = 1;
+
+  EXPECT_TRUE(_trie.has(key));
+  EXPECT_TRUE(_trie.has(static_cast<const char *>(key)));
+  EXPECT_EQ(1, _trie[key]);
+  EXPECT_EQ(1, _trie.size());
+}
+
+TEST_F(TrieTest, Const_Reads) {
+  _trie["panda"] = 1;
+  _trie["pandas"] = 2;
+  _trie["polar"] = 3;
+  const auto &reader = _trie;
+  const size_t nodes = _trie.size();
+
+  EXPECT_TRUE(reader.has("panda"));
+  EXPECT_FALSE(reader.has("pand"));
+  EXPECT_FALSE(reader.has("pand!"));
+  EXPECT_FALSE(_trie.has("pand!"));
+  EXPECT_EQ(3, reader.find("polar")->value());
+  EXPECT_EQ(nullptr, reader.find("pandas!").operator->());
+
+  EXPECT_EQ(2, *reader.try_get("pandas"));
+  EXPECT_EQ(nullptr, reader.try_get("pand"));
+  EXPECT_EQ(nullptr, reader.try_get("koala"));
+  EXPECT_EQ(1, reader.at("panda"));
+  EXPECT_THROW(reader.at("pan"), error::key_not_found);
+  EXPECT_THROW(reader.at("pan!"), std::out_of_range);
+
+  *_trie.try_get("panda") = 4;
+  _trie.at("polar") = 5;
+  EXPECT_EQ(4, reader.at("panda"));
+  EXPECT_EQ(5, reader.at("polar"));
+  EXPECT_EQ(nodes, _trie.size());
+  EXPECT_FALSE(reader.has("pan"));
+
+  std::vector<std::string> keys;
+  for (auto &node : reader)
+    keys.push_back(node.key<std::string>());
+  EXPECT_EQ(std::vector<std::string>({ "panda", "pandas", "polar" }), keys);
+
+  std::vector<int> values;
+  for (auto it = reader.rbegin(); it != reader.rend(); ++it)
+    values.push_back(it->value());
+  EXPECT_EQ(std::vector<int>({ 5, 2, 4 }), values);
+
+  trie<char, int>::const_iterator it = _trie.begin();
+  EXPECT_TRUE(it == _trie.cbegin());
+  EXPECT_TRUE(++it != _trie.cend());
+}
+
+TEST_F(TrieTest, Insert) {
+  const std::string buffer = "grizzlybear";
+
+  auto result = _trie.insert(buffer.begin(), buffer.begin() + 7, 4);
+  EXPECT_TRUE(result.second);
+  EXPECT_EQ(4, result.first->value());
+
+  result = _trie.insert("grizzly", 5);
+  EXPECT_FALSE(result.second);
+  EXPECT_EQ(4, result.first->value());
+
+  result = _trie.insert(buffer.data() + 7, 4, 6);
+  EXPECT_TRUE(result.second);
+  EXPECT_TRUE(_trie.has("bear"));
+  EXPECT_EQ(2, _trie.size());
+}
+
+TEST_F(TrieTest, Key_Into) {
+  _trie["grizzly"] = 4;
+  char buffer[8] = {};
+
+  EXPECT_EQ(7, _trie.begin()->key_into(buffer, sizeof buffer));
+  EXPECT_STREQ("grizzly", buffer);
+  EXPECT_EQ(7, _trie.begin()->depth());
+
+  char small[4] = {};
+  EXPECT_EQ(7, _trie.begin()->key_into(small, sizeof small));
+  EXPECT_STREQ("", small);
+}
+
+TEST_F(TrieTest, Longest_Prefix_Match) {
+  _trie["p"] = 1;
+  _trie["pan"] = 2;
+  _trie["panda"] = 3;
+
+  EXPECT_EQ(3, _trie.longest_prefix_match("pandas")->value());
+  EXPECT_EQ(2, _trie.longest_prefix_match("pang")->value());
+  EXPECT_EQ(1, _trie.longest_prefix_match("p!")->value());
+  EXPECT_EQ(nullptr, _trie.longest_prefix_match("koala").operator->());
+  EXPECT_EQ("pan", _trie.longest_prefix_match(std::string("panama"))->key<std::string>());
+
+  /* the empty key matches at the root, which is end() but not a miss */
+  _trie[""] = 4;
+  EXPECT_EQ(_trie.end(), _trie.longest_prefix_match("koala"));
+  EXPECT_EQ(4, _trie.longest_prefix_match("koala")->value());
+  EXPECT_EQ(1, _trie.longest_prefix_match("p!")->value());
+}
+
+TEST_F(TrieTest, Prefixes_Of) {
+  _trie["p"] = 1;
+  _trie["pan"] = 2;
+  _trie["panda"] = 3;
+  _trie["polar"] = 4;
+
+  std::vector<decltype(_trie)::iterator> prefixes;
+  _trie.prefixes_of("pandas", std::back_inserter(prefixes));
+
+  ASSERT_EQ(3, prefixes.size());
+  EXPECT_EQ(1, prefixes[0]->value());
+  EXPECT_EQ(2, prefixes[1]->value());
+  EXPECT_EQ(3, prefixes[2]->value());
+}
+
+TEST_F(TrieTest, Cursor) {
+  _trie["pan"] = 2;
+  _trie["panda"] = 3;
+
+  auto cursor = _trie.cursor();
+  EXPECT_TRUE(cursor.advance(std::string("pa")));
+  EXPECT_FALSE(cursor.matched());
+
+  EXPECT_TRUE(cursor.advance(std::string("nd")));
+  EXPECT_TRUE(cursor.matched());
+  EXPECT_EQ(3, cursor.match_length());
+  EXPECT_EQ(2, cursor.match()->value());
+
+  EXPECT_TRUE(cursor.advance('a'));
+  EXPECT_EQ(5, cursor.match_length());
+  EXPECT_FALSE(cursor.advance('s'));
+  EXPECT_FALSE(cursor.alive());
+  EXPECT_EQ(3, cursor.match()->value());
+
+  cursor.reset();
+  EXPECT_FALSE(cursor.matched());
+  EXPECT_EQ(nullptr, cursor.match().operator->());
+
+  _trie[""] = 1;
+  cursor.reset();
+  EXPECT_TRUE(cursor.matched());
+  EXPECT_EQ(_trie.end(), cursor.match());
+  EXPECT_EQ(0, cursor.match_length());
+}
+
+TEST_F(TrieTest, Fuzzy_Find) {
+  _trie["panda"] = 1;
+  _trie["pandas"] = 2;
+  _trie["pond"] = 3;
+  _trie["polar"] = 4;
+  _trie["koala"] = 5;
+
+  std::vector<std::pair<decltype(_trie)::iterator, size_t>> matches;
+  _trie.fuzzy_find("pamda", 1, std::back_inserter(matches));
+
+  ASSERT_EQ(1, matches.size());
+  EXPECT_EQ("panda", matches[0].first->key<std::string>());
+  EXPECT_EQ(1, matches[0].second);
+
+  matches.clear();
+  _trie.fuzzy_find("panda", 2, std::back_inserter(matches));
+
+  ASSERT_EQ(3, matches.size());
+  EXPECT_EQ("panda", matches[0].first->key<std::string>());
+  EXPECT_EQ(0, matches[0].second);
+  EXPECT_EQ("pandas", matches[1].first->key<std::string>());
+  EXPECT_EQ(1, matches[1].second);
+  EXPECT_EQ("pond", matches[2].first->key<std::string>());
+  EXPECT_EQ(2, matches[2].second);
+}
+
+TEST_F(TrieTest, Fuzzy_Find_Agrees_With_Brute_Force) {
+  std::vector<std::string> words = { "a", "ab", "abc", "bca", "cab", "cb", "abcd", "dcba", "bbb", "" };
+  for (auto &it : words)
+    _trie[it] = 1;
+
+  auto distance = [](const std::string &a, const std::string &b) {
+    std::vector<size_t> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j)
+      row[j] = j;
+    for (size_t i = 1; i <= a.size(); ++i) {
+      size_t diagonal = row[0];
+      row[0] = i;
+      for (size_t j = 1; j <= b.size(); ++j) {
+        size_t above = row[j];
+        row[j] = (std::min)((std::min)(row[j], row[j - 1]) + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1));
+        diagonal = above;
+      }
+    }
+    return row[b.size()];
+  };
+
+  for (auto &query : { "abc", "ba", "x", "" })
+    for (size_t max = 0; max <= 2; ++max) {
+      std::vector<std::pair<decltype(_trie)::iterator, size_t>> matches;
+      _trie.fuzzy_find(query, max, std::back_inserter(matches));
+
+      std::set<std::string> expected, actual;
+      for (auto &it : words)
+        if (distance(query, it) <= max)
+          expected.insert(it);
+      for (auto &it : matches) {
+        actual.insert(it.first->key<std::string>());
+        EXPECT_EQ(distance(query, it.first->key<std::string>()), it.second);
+      }
+      EXPECT_EQ(expected, actual) << query << " within " << max;
+    }
+}
+
+TEST_F(TrieTest, Merge) {
+  trie<char, int> other(_alpha);
+  _trie["panda"] = 1;
+  _trie["polar"] = 2;
+  other["polar"] = 20;
+  other["pola"] = 30;
+  other["koala"] = 40;
+  other[""] = 50;
+
+  _trie.merge(std::move(other), [](int mine, int theirs) { return mine + theirs; });
+
+  EXPECT_EQ(5, _trie.size());
+  EXPECT_EQ(1, _trie["panda"]);
+  EXPECT_EQ(22, _trie["polar"]);
+  EXPECT_EQ(30, _trie["pola"]);
+  EXPECT_EQ(40, _trie["koala"]);
+  EXPECT_EQ(50, _trie[""]);
+  EXPECT_EQ(0, other.size());
+  EXPECT_TRUE(other.begin() == other.end());
+
+  other["polar"] = 3;
+  _trie.merge(std::move(other));
+  EXPECT_EQ(22, _trie["polar"]);
+}
+
+TEST_F(TrieTest, Intersect) {
+  trie<char, int> other(_alpha);
+  _trie["panda"] = 1;
+  _trie["polar"] = 2;
+  _trie["pol"] = 3;
+  _trie["koala"] = 4;
+  other["polar"] = 20;
+  other["po"] = 30;
+  other["koala"] = 40;
+
+  _trie.intersect(other, [](int mine, int theirs) { return theirs - mine; });
+
+  EXPECT_EQ(2, _trie.size());
+  EXPECT_EQ(18, _trie["polar"]);
+  EXPECT_EQ(36, _trie["koala"]);
+  EXPECT_FALSE(_trie.has("pol"));
+  EXPECT_FALSE(_trie.has("po"));
+  EXPECT_EQ(3, other.size());
+
+  _trie.intersect(trie<char, int>(_alpha));
+  EXPECT_EQ(0, _trie.size());
+  EXPECT_TRUE(_trie.begin() == _trie.end());
+}
+
+TEST_F(TrieTest, Difference) {
+  trie<char, int> other(_alpha);
+  _trie["panda"] = 1;
+  _trie["polar"] = 2;
+  _trie["pol"] = 3;
+  _trie["koala"] = 4;
+  other["polar"] = 20;
+  other["pola"] = 30;
+  other["grizzly"] = 40;
+
+  _trie.difference(other);
+
+  EXPECT_EQ(3, _trie.size());
+  EXPECT_EQ(1, _trie["panda"]);
+  EXPECT_EQ(3, _trie["pol"]);
+  EXPECT_EQ(4, _trie["koala"]);
+  EXPECT_FALSE(_trie.has("polar"));
+
+  _trie.difference(_trie);
+  EXPECT_EQ(0, _trie.size());
+}
+
+TEST_F(TrieTest, Set_Operations_Alphabet_Mismatch) {
+  trie<char, int> other("abc");
+  EXPECT_THROW(_trie.merge(std::move(other)), error::alphabet_mismatch);
+  EXPECT_THROW(_trie.intersect(other), error::alphabet_mismatch);
+  EXPECT_THROW(_trie.difference(other), error::alphabet_mismatch);
+}
+
 
 struct iless {
   bool operator ()(const char &left, const char &right) const {
@@ -318,6 +870,19 @@ public:
   InsensitveTrieTest() : _trie(_alpha) {}
 };
 
+TEST_F(InsensitveTrieTest, Cache_Shares_Equal_Keys) {
+  _trie.enable_cache(16);
+  _trie["panda"] = 1;
+
+  EXPECT_TRUE(_trie.has("panda"));
+  EXPECT_TRUE(_trie.has("PANDA"));
+  EXPECT_EQ(1, _trie.cache()->hits());
+
+  _trie.erase("PaNdA");
+  EXPECT_FALSE(_trie.has("panda"));
+  EXPECT_FALSE(_trie.has("PANDA"));
+}
+
 TEST_F(InsensitveTrieTest, Basic_Insert) {
   _trie["pAnDa"] = 1;
   _trie["pOLAR"] = 2;
@@ -330,3 +895,126 @@ TEST_F(InsensitveTrieTest, Basic_Insert) {
   EXPECT_EQ(4, _trie["GRIZZLY"]);
 }
 
+
+
+class WideTrieTest : public ::testing::Test {
+public:
+  trie<wchar_t, int> _trie;
+
+  WideTrieTest() : _trie(alphabet_of(0x4e00, 3000)) {}
+
+  static std::wstring alphabet_of(wchar_t first, int size) {
+    std::wstring result;
+    for (int i = 0; i < size; ++i)
+      result += wchar_t(first + i);
+    return result;
+  }
+};
+
+TEST_F(WideTrieTest, Basic_Insert_Retrieval) {
+  _trie[L"\u4e2d\u5165"] = 1;
+  _trie[L"\u4e2d"] = 2;
+  _trie[L"\u557f"] = 3;
+
+  EXPECT_EQ(1, _trie[L"\u4e2d\u5165"]);
+  EXPECT_EQ(2, _trie[L"\u4e2d"]);
+  EXPECT_EQ(3, _trie[L"\u557f"]);
+  EXPECT_FALSE(_trie.has(L"\u5165"));
+  EXPECT_FALSE(_trie.has(L"a"));
+  EXPECT_EQ(nullptr, _trie.try_get(L"\u4e2da"));
+  EXPECT_THROW(_trie[L"a"], error::not_in_alphabet);
+}
+
+TEST_F(WideTrieTest, Agrees_With_Map) {
+  std::map<std::wstring, int> expected;
+  std::mt19937 gen(42);
+
+  for (int i = 0; i < 5000; ++i) {
+    std::wstring key(1 + gen() % 4, L' ');
+    for (auto &ch : key)
+      ch = wchar_t(0x4e00 + (i % 2 ? gen() % 3000 : gen() % 70));
+    expected[key] = i;
+    _trie[key] = i;
+  }
+
+  std::vector<std::wstring> keys;
+  for (auto &it : expected)
+    keys.push_back(it.first);
+  std::shuffle(keys.begin(), keys.end(), gen);
+  for (size_t i = 0; i < keys.size() / 2; ++i) {
+    expected.erase(keys[i]);
+    EXPECT_EQ(1, _trie.erase(keys[i]));
+  }
+
+  EXPECT_EQ(expected.size(), _trie.size());
+
+  auto it = expected.begin();
+  for (auto &node : _trie) {
+    ASSERT_TRUE(it != expected.end());
+    EXPECT_TRUE(it->first == node.key<std::wstring>());
+    EXPECT_EQ(it->second, node.value());
+    ++it;
+  }
+  EXPECT_TRUE(it == expected.end());
+
+  auto rit = expected.rbegin();
+  for (auto node = _trie.rbegin(); node != _trie.rend(); ++node, ++rit)
+    EXPECT_TRUE(rit->first == node->key<std::wstring>());
+  EXPECT_TRUE(rit == expected.rend());
+}
+
+TEST_F(WideTrieTest, Set_Operations_Agree_With_Map) {
+  std::mt19937 gen(7);
+  auto fill = [&](trie<wchar_t, int> &target, std::map<std::wstring, int> &expected) {
+    for (int i = 0; i < 2000; ++i) {
+      std::wstring key(1 + gen() % 3, L' ');
+      for (auto &ch : key)
+        ch = wchar_t(0x4e00 + (i % 2 ? gen() % 3000 : gen() % 40));
+      expected[key] = i;
+      target[key] = i;
+    }
+  };
+  auto contents = [](trie<wchar_t, int> &source) {
+    std::map<std::wstring, int> result;
+    for (auto &node : source)
+      result[node.key<std::wstring>()] = node.value();
+    return result;
+  };
+
+  std::map<std::wstring, int> left, right;
+  trie<wchar_t, int> other(alphabet_of(0x4e00, 3000));
+  fill(_trie, left);
+  fill(other, right);
+
+  std::map<std::wstring, int> merged = left, common, remaining;
+  for (auto &it : right) {
+    merged[it.first] = left.count(it.first) ? (std::max)(left[it.first], it.second) : it.second;
+    if (left.count(it.first))
+      common[it.first] = left[it.first];
+  }
+  for (auto &it : left)
+    if (!right.count(it.first))
+      remaining[it.first] = it.second;
+
+  trie<wchar_t, int> copy(alphabet_of(0x4e00, 3000));
+  for (auto &it : left)
+    copy[it.first] = it.second;
+
+  copy.difference(other);
+  EXPECT_TRUE(remaining == contents(copy));
+
+  copy.clear();
+  for (auto &it : left)
+    copy[it.first] = it.second;
+  copy.intersect(other);
+  EXPECT_TRUE(common == contents(copy));
+
+  _trie.merge(std::move(other), [](int mine, int theirs) { return (std::max)(mine, theirs); });
+  EXPECT_TRUE(merged == contents(_trie));
+  EXPECT_EQ(0, other.size());
+
+  auto rit = merged.rbegin();
+  for (auto node = _trie.rbegin(); node != _trie.rend(); ++node, ++rit)
+    EXPECT_TRUE(rit->first == node->key<std::wstring>());
+  EXPECT_TRUE(rit == merged.rend());
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include "../src/utf8_trie.h"
+#include <algorithm>
+
+class Utf8TrieTest : public ::testing::Test {
+public:
+  utf8_trie<int> _trie;
+};
+
+TEST_F(Utf8TrieTest, Insert_Retrieval) {
+  _trie["panda"] = 1;
+  _trie["\xe7\x86\x8a\xe7\x8c\xab"] = 2;
+  _trie[std::string("caf\xc3\xa9")] = 3;
+
+  EXPECT_EQ(1, _trie["panda"]);
+  EXPECT_EQ(2, _trie["\xe7\x86\x8a\xe7\x8c\xab"]);
+  EXPECT_TRUE(_trie.has("caf\xc3\xa9"));
+  EXPECT_FALSE(_trie.has("caf\xc3"));
+  EXPECT_EQ(3, _trie.size());
+}
+
+TEST_F(Utf8TrieTest, Iterates_In_Code_Point_Order) {
+  std::vector<std::u32string> keys = {
+    U"b", U"\u00e9", U"\u00e9t\u00e9", U"\u4e2d", U"\u4e2d\u6587", U"\U0001f43c", U"a\U0001f43c", U"\u007f", U"ab"
+  };
+  for (auto &it : keys)
+    _trie[utf8::encode(it)] = 1;
+
+  std::vector<std::u32string> actual;
+  for (auto &it : _trie)
+    actual.push_back(utf8_trie<int>::code_points(it));
+
+  std::sort(keys.begin(), keys.end());
+  EXPECT_TRUE(keys == actual);
+}
+
+TEST_F(Utf8TrieTest, Decode) {
+  EXPECT_TRUE(U"caf\u00e9" == utf8::decode(std::string("caf\xc3\xa9")));
+  EXPECT_TRUE(U"\U0001f43c" == utf8::decode(std::string("\xf0\x9f\x90\xbc")));
+  EXPECT_TRUE(U"a\ufffdb" == utf8::decode(std::string("a\xc3" "b")));
+  EXPECT_TRUE(U"\ufffd\ufffd" == utf8::decode(std::string("\x80\xff")));
+
+  /* the ends of the ranges the second byte narrows */
+  EXPECT_TRUE(U"\u0800\ud7ff\U00010000\U0010ffff" == utf8::decode(std::string("\xe0\xa0\x80\xed\x9f\xbf\xf0\x90\x80\x80\xf4\x8f\xbf\xbf")));
+  /* overlong forms, a surrogate and a value past U+10FFFF, each byte replaced */
+  EXPECT_TRUE(U"\ufffd\ufffd\ufffd" == utf8::decode(std::string("\xe0\x80\x80")));
+  EXPECT_TRUE(U"\ufffd\ufffd\ufffd\ufffd" == utf8::decode(std::string("\xf0\x8f\xbf\xbf")));
+  EXPECT_TRUE(U"\ufffd\ufffd\ufffd" == utf8::decode(std::string("\xed\xa0\x80")));
+  EXPECT_TRUE(U"\ufffd\ufffd\ufffd\ufffd" == utf8::decode(std::string("\xf4\x90\x80\x80")));
+}
+
+TEST_F(Utf8TrieTest, Byte_Subset_Alphabet) {
+  utf8_trie<int> subset(std::string("abc\xe4\xb8\xad\xe6\x96\x87"));
+  subset["\xe4\xb8\xad\xe6\x96\x87"] = 1;
+  subset["abc"] = 2;
+
+  EXPECT_EQ(1, subset["\xe4\xb8\xad\xe6\x96\x87"]);
+  EXPECT_THROW(subset["d"], error::not_in_alphabet);
+  EXPECT_EQ("abc", subset.begin()->key<std::string>());
+}